@@ -42,7 +42,28 @@ namespace UB
             bool                    _singleStep;
             bool                    _noUI;
             bool                    _noColors;
+            bool                    _benchmark;
+            bool                    _nativeCPUID;
+            bool                    _commitDisk;
             size_t                  _memory;
+            std::string             _memoryFile;
+            size_t                  _diskCache;
+            std::string             _makeSparse;
+            unsigned int            _fps;
+            size_t                  _logLines;
+            std::string             _outputLog;
+            std::string             _debugLog;
+            std::string             _trace;
+            bool                    _traceRegisters;
+            bool                    _traceWrites;
+            std::string             _coverage;
+            std::string             _coverageList;
+            bool                    _profile;
+            std::string             _query;
+            uint64_t                _queryAt;
+            size_t                  _queryCount;
+            std::string             _queryWrites;
+            std::string             _queryExec;
             std::string             _bootImage;
             std::vector< uint64_t > _breakpoints;
     };
@@ -109,11 +130,116 @@ namespace UB
         return this->impl->_noColors;
     }
     
+    bool Arguments::benchmark( void ) const
+    {
+        return this->impl->_benchmark;
+    }
+    
+    bool Arguments::nativeCPUID( void ) const
+    {
+        return this->impl->_nativeCPUID;
+    }
+    
+    bool Arguments::commitDisk( void ) const
+    {
+        return this->impl->_commitDisk;
+    }
+    
     size_t Arguments::memory( void ) const
     {
         return this->impl->_memory;
     }
     
+    std::string Arguments::memoryFile( void ) const
+    {
+        return this->impl->_memoryFile;
+    }
+    
+    size_t Arguments::diskCache( void ) const
+    {
+        return this->impl->_diskCache;
+    }
+    
+    std::string Arguments::makeSparse( void ) const
+    {
+        return this->impl->_makeSparse;
+    }
+    
+    unsigned int Arguments::fps( void ) const
+    {
+        return this->impl->_fps;
+    }
+    
+    size_t Arguments::logLines( void ) const
+    {
+        return this->impl->_logLines;
+    }
+    
+    std::string Arguments::outputLog( void ) const
+    {
+        return this->impl->_outputLog;
+    }
+    
+    std::string Arguments::debugLog( void ) const
+    {
+        return this->impl->_debugLog;
+    }
+    
+    std::string Arguments::trace( void ) const
+    {
+        return this->impl->_trace;
+    }
+    
+    bool Arguments::traceRegisters( void ) const
+    {
+        return this->impl->_traceRegisters;
+    }
+    
+    bool Arguments::traceWrites( void ) const
+    {
+        return this->impl->_traceWrites;
+    }
+    
+    std::string Arguments::coverage( void ) const
+    {
+        return this->impl->_coverage;
+    }
+    
+    std::string Arguments::coverageList( void ) const
+    {
+        return this->impl->_coverageList;
+    }
+    
+    bool Arguments::profile( void ) const
+    {
+        return this->impl->_profile;
+    }
+    
+    std::string Arguments::query( void ) const
+    {
+        return this->impl->_query;
+    }
+    
+    uint64_t Arguments::queryAt( void ) const
+    {
+        return this->impl->_queryAt;
+    }
+    
+    size_t Arguments::queryCount( void ) const
+    {
+        return this->impl->_queryCount;
+    }
+    
+    std::string Arguments::queryWrites( void ) const
+    {
+        return this->impl->_queryWrites;
+    }
+    
+    std::string Arguments::queryExec( void ) const
+    {
+        return this->impl->_queryExec;
+    }
+    
     std::string Arguments::bootImage( void ) const
     {
         return this->impl->_bootImage;
@@ -140,7 +266,18 @@ namespace UB
         _singleStep(             false ),
         _noUI(                   false ),
         _noColors(               false ),
-        _memory(                 0 )
+        _benchmark(              false ),
+        _nativeCPUID(            false ),
+        _commitDisk(             false ),
+        _memory(                 0 ),
+        _diskCache(              0 ),
+        _fps(                    30 ),
+        _logLines(               10000 ),
+        _traceRegisters(         false ),
+        _traceWrites(            false ),
+        _profile(                false ),
+        _queryAt(                0 ),
+        _queryCount(             20 )
     {
         if( argc < 1 )
         {
@@ -183,6 +320,18 @@ namespace UB
             {
                 this->_noColors = true;
             }
+            else if( arg == "--benchmark" )
+            {
+                this->_benchmark = true;
+            }
+            else if( arg == "--native-cpuid" )
+            {
+                this->_nativeCPUID = true;
+            }
+            else if( arg == "--commit-disk" )
+            {
+                this->_commitDisk = true;
+            }
             else if( arg == "--memory" || arg == "-m" )
             {
                 if( ++i < argc )
@@ -195,6 +344,148 @@ namespace UB
                     {}
                 }
             }
+            else if( arg == "--memory-file" )
+            {
+                if( ++i < argc )
+                {
+                    this->_memoryFile = argv[ i ];
+                }
+            }
+            else if( arg == "--disk-cache" )
+            {
+                if( ++i < argc )
+                {
+                    try
+                    {
+                        this->_diskCache = static_cast< size_t >( std::atoll( argv[ i ] ) );
+                    }
+                    catch( ... )
+                    {}
+                }
+            }
+            else if( arg == "--make-sparse" )
+            {
+                if( ++i < argc )
+                {
+                    this->_makeSparse = argv[ i ];
+                }
+            }
+            else if( arg == "--fps" )
+            {
+                if( ++i < argc )
+                {
+                    try
+                    {
+                        this->_fps = static_cast< unsigned int >( std::atoi( argv[ i ] ) );
+                    }
+                    catch( ... )
+                    {}
+                }
+            }
+            else if( arg == "--log-lines" )
+            {
+                if( ++i < argc )
+                {
+                    try
+                    {
+                        this->_logLines = static_cast< size_t >( std::atoll( argv[ i ] ) );
+                    }
+                    catch( ... )
+                    {}
+                }
+            }
+            else if( arg == "--output-log" )
+            {
+                if( ++i < argc )
+                {
+                    this->_outputLog = argv[ i ];
+                }
+            }
+            else if( arg == "--debug-log" )
+            {
+                if( ++i < argc )
+                {
+                    this->_debugLog = argv[ i ];
+                }
+            }
+            else if( arg == "--trace" )
+            {
+                if( ++i < argc )
+                {
+                    this->_trace = argv[ i ];
+                }
+            }
+            else if( arg == "--trace-regs" )
+            {
+                this->_traceRegisters = true;
+            }
+            else if( arg == "--trace-writes" )
+            {
+                this->_traceWrites = true;
+            }
+            else if( arg == "--coverage" )
+            {
+                if( ++i < argc )
+                {
+                    this->_coverage = argv[ i ];
+                }
+            }
+            else if( arg == "--coverage-txt" )
+            {
+                if( ++i < argc )
+                {
+                    this->_coverageList = argv[ i ];
+                }
+            }
+            else if( arg == "--profile" )
+            {
+                this->_profile = true;
+            }
+            else if( arg == "--query" )
+            {
+                if( ++i < argc )
+                {
+                    this->_query = argv[ i ];
+                }
+            }
+            else if( arg == "--query-at" )
+            {
+                if( ++i < argc )
+                {
+                    try
+                    {
+                        this->_queryAt = static_cast< uint64_t >( std::strtoull( argv[ i ], 0, 10 ) );
+                    }
+                    catch( ... )
+                    {}
+                }
+            }
+            else if( arg == "--query-count" )
+            {
+                if( ++i < argc )
+                {
+                    try
+                    {
+                        this->_queryCount = static_cast< size_t >( std::atoll( argv[ i ] ) );
+                    }
+                    catch( ... )
+                    {}
+                }
+            }
+            else if( arg == "--query-writes" )
+            {
+                if( ++i < argc )
+                {
+                    this->_queryWrites = argv[ i ];
+                }
+            }
+            else if( arg == "--query-exec" )
+            {
+                if( ++i < argc )
+                {
+                    this->_queryExec = argv[ i ];
+                }
+            }
             else if( arg == "--break" || arg == "-b" )
             {
                 if( ++i < argc )
@@ -223,7 +514,28 @@ namespace UB
         _singleStep(              o._singleStep ),
         _noUI(                    o._noUI ),
         _noColors(                o._noColors ),
+        _benchmark(               o._benchmark ),
+        _nativeCPUID(             o._nativeCPUID ),
+        _commitDisk(              o._commitDisk ),
         _memory(                  o._memory ),
+        _memoryFile(              o._memoryFile ),
+        _diskCache(               o._diskCache ),
+        _makeSparse(              o._makeSparse ),
+        _fps(                     o._fps ),
+        _logLines(                o._logLines ),
+        _outputLog(               o._outputLog ),
+        _debugLog(                o._debugLog ),
+        _trace(                   o._trace ),
+        _traceRegisters(          o._traceRegisters ),
+        _traceWrites(             o._traceWrites ),
+        _coverage(                o._coverage ),
+        _coverageList(            o._coverageList ),
+        _profile(                 o._profile ),
+        _query(                   o._query ),
+        _queryAt(                 o._queryAt ),
+        _queryCount(              o._queryCount ),
+        _queryWrites(             o._queryWrites ),
+        _queryExec(               o._queryExec ),
         _bootImage(               o._bootImage ),
         _breakpoints(             o._breakpoints )
     {}
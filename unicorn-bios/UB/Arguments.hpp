@@ -51,7 +51,28 @@ namespace UB
             bool                    singleStep( void )             const;
             bool                    noUI( void )                   const;
             bool                    noColors( void )               const;
+            bool                    benchmark( void )              const;
+            bool                    nativeCPUID( void )            const;
+            bool                    commitDisk( void )             const;
             size_t                  memory( void )                 const;
+            std::string             memoryFile( void )             const;
+            size_t                  diskCache( void )              const;
+            std::string             makeSparse( void )             const;
+            unsigned int            fps( void )                    const;
+            size_t                  logLines( void )               const;
+            std::string             outputLog( void )              const;
+            std::string             debugLog( void )               const;
+            std::string             trace( void )                  const;
+            bool                    traceRegisters( void )         const;
+            bool                    traceWrites( void )            const;
+            std::string             coverage( void )               const;
+            std::string             coverageList( void )           const;
+            bool                    profile( void )                const;
+            std::string             query( void )                  const;
+            uint64_t                queryAt( void )                const;
+            size_t                  queryCount( void )             const;
+            std::string             queryWrites( void )            const;
+            std::string             queryExec( void )              const;
             std::string             bootImage( void )              const;
             std::vector< uint64_t > breakpoints( void )            const;
             
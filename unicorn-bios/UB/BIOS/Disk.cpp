@@ -28,6 +28,8 @@
 #include "UB/String.hpp"
 #include "UB/Casts.hpp"
 #include "UB/FAT/Functions.hpp"
+#include "UB/BinaryDataStream.hpp"
+#include "UB/Bytes.hpp"
 
 namespace UB
 {
@@ -35,6 +37,16 @@ namespace UB
     {
         namespace Disk
         {
+            enum class Operation
+            {
+                Read,
+                Write,
+                Verify,
+                Seek
+            };
+            
+            static bool extendedTransfer( Machine & machine, Engine & engine, Operation operation );
+            
             bool reset( const Machine & machine, Engine & engine )
             {
                 machine.ui().debug() << "Resetting drive " << String::toHex( engine.dl() ) << std::endl;
@@ -47,13 +59,14 @@ namespace UB
             
             bool readSectors( const Machine & machine, Engine & engine )
             {
-                uint8_t    driveNumber( engine.dl() );
-                uint8_t    sectors(     engine.al() );
-                uint8_t    cylinder(    engine.ch() );
-                uint8_t    sector(      engine.cl() );
-                uint8_t    head(        engine.dh() );
-                uint64_t   destination( Engine::getAddress( engine.es(), engine.bx() ) );
-                FAT::Image image(       machine.bootImage() );
+                uint8_t            driveNumber( engine.dl() );
+                uint8_t            sectors(     engine.al() );
+                uint8_t            cylinder(    engine.ch() );
+                uint8_t            sector(      engine.cl() );
+                uint8_t            head(        engine.dh() );
+                uint64_t           destination( Engine::getAddress( engine.es(), engine.bx() ) );
+                const FAT::Image & image(       machine.bootImage() );
+                uint8_t            status(      1 );
                 
                 if( driveNumber != 0x00 )
                 {
@@ -76,23 +89,46 @@ namespace UB
                                      << std::endl;
                 
                 {
-                    std::vector< uint8_t > bytes( image.read( cylinder, head, sector, sectors ) );
+                    uint64_t bytesPerSector( image.mbr().bytesPerSector() );
+                    uint64_t offset( FAT::chsToLBA( image.mbr(), cylinder, sector, head ) * bytesPerSector );
+                    size_t   size( static_cast< size_t >( sectors ) * bytesPerSector );
                     
-                    if( bytes.size() == 0 )
+                    if( size == 0 )
                     {
                         machine.ui().debug() << "[ ERROR ]> No data received" << std::endl;
                         
                         goto error;
                     }
                     
-                    engine.write( destination, bytes );
+                    if( destination > engine.memory() || size > engine.memory() - destination )
+                    {
+                        machine.ui().debug() << "[ ERROR ]> Destination out of memory" << std::endl;
+                        
+                        status = 4;
+                        
+                        goto error;
+                    }
+                    
+                    /*
+                     * Sectors are copied directly from the image to guest
+                     * memory, without any intermediate buffer.
+                     */
+                    image.read
+                    (
+                        offset,
+                        size,
+                        [ & ]( uint64_t position, const uint8_t * bytes, size_t length )
+                        {
+                            engine.write( destination + position, bytes, length );
+                        }
+                    );
                     
                     machine.ui().debug() << "[ SUCCESS ]> Wrote "
-                                         << bytes.size()
+                                         << size
                                          << " bytes at "
                                          << String::toHex( destination )
                                          << " -> "
-                                         << String::toHex( destination + bytes.size() )
+                                         << String::toHex( destination + size )
                                          << std::endl;
                     
                     engine.cf( false );
@@ -105,11 +141,370 @@ namespace UB
                 error:
                     
                     engine.cf( true );
-                    engine.ah( 1 );
+                    engine.ah( status );
+                    engine.al( 0 );
+                    
+                    return true;
+            }
+            
+            bool writeSectors( Machine & machine, Engine & engine )
+            {
+                uint8_t      driveNumber( engine.dl() );
+                uint8_t      sectors(     engine.al() );
+                uint8_t      cylinder(    engine.ch() );
+                uint8_t      sector(      engine.cl() );
+                uint8_t      head(        engine.dh() );
+                uint64_t     source(      Engine::getAddress( engine.es(), engine.bx() ) );
+                FAT::Image & image(       machine.bootImage() );
+                uint8_t      status(      1 );
+                
+                if( driveNumber != 0x00 )
+                {
+                    machine.ui().debug() << "[ ERROR ]> Writing to drive " << String::toHex( driveNumber ) << " is not supported" << std::endl;
+                    
+                    goto error;
+                }
+                
+                machine.ui().debug() << "Writing " << static_cast< unsigned int >( sectors ) << " sector" << ( ( sectors > 1 ) ? "s" : "" ) << " to drive " << String::toHex( driveNumber )
+                                     << std::endl
+                                     << "    - Cylinder:    " << String::toHex( cylinder )
+                                     << std::endl
+                                     << "    - Head:        " << String::toHex( head )
+                                     << std::endl
+                                     << "    - Sector:      " << String::toHex( sector )
+                                     << std::endl
+                                     << "    - LBA:         " << String::toHex( FAT::chsToLBA( image.mbr(), cylinder, sector, head ) )
+                                     << std::endl
+                                     << "    - Source:      " << String::toHex( source ) << " (" << String::toHex( engine.es() ) << ":" << String::toHex( engine.bx() ) << ")"
+                                     << std::endl;
+                
+                {
+                    uint64_t bytesPerSector( image.mbr().bytesPerSector() );
+                    uint64_t offset( FAT::chsToLBA( image.mbr(), cylinder, sector, head ) * bytesPerSector );
+                    size_t   size( static_cast< size_t >( sectors ) * bytesPerSector );
+                    
+                    if( size == 0 || offset > image.size() || size > image.size() - offset )
+                    {
+                        machine.ui().debug() << "[ ERROR ]> Sectors out of range" << std::endl;
+                        
+                        goto error;
+                    }
+                    
+                    if( source > engine.memory() || size > engine.memory() - source )
+                    {
+                        machine.ui().debug() << "[ ERROR ]> Source out of memory" << std::endl;
+                        
+                        status = 4;
+                        
+                        goto error;
+                    }
+                    
+                    image.write( offset, engine.view( source, size ), size );
+                    
+                    machine.ui().debug() << "[ SUCCESS ]> Wrote "
+                                         << size
+                                         << " bytes from "
+                                         << String::toHex( source )
+                                         << " -> "
+                                         << String::toHex( source + size )
+                                         << std::endl;
+                    
+                    engine.cf( false );
+                    engine.ah( 0 );
+                    engine.al( sectors );
+                    
+                    return true;
+                }
+                
+                error:
+                    
+                    engine.cf( true );
+                    engine.ah( status );
                     engine.al( 0 );
                     
                     return true;
             }
+            
+            bool checkExtensions( const Machine & machine, Engine & engine )
+            {
+                uint8_t driveNumber( engine.dl() );
+                
+                machine.ui().debug() << "Checking extensions for drive " << String::toHex( driveNumber ) << std::endl;
+                
+                if( engine.bx() != 0x55AA || driveNumber != 0x00 )
+                {
+                    engine.cf( true );
+                    engine.ah( 1 );
+                    
+                    return true;
+                }
+                
+                /*
+                 * EDD 3.0, with support for the fixed disk access subset of
+                 * functions (bit 0).
+                 */
+                engine.cf( false );
+                engine.ah( 0x30 );
+                engine.bx( 0xAA55 );
+                engine.cx( 0x0001 );
+                
+                return true;
+            }
+            
+            bool extendedReadSectors( Machine & machine, Engine & engine )
+            {
+                return extendedTransfer( machine, engine, Operation::Read );
+            }
+            
+            bool extendedWriteSectors( Machine & machine, Engine & engine )
+            {
+                return extendedTransfer( machine, engine, Operation::Write );
+            }
+            
+            bool verifySectors( Machine & machine, Engine & engine )
+            {
+                return extendedTransfer( machine, engine, Operation::Verify );
+            }
+            
+            bool extendedSeek( Machine & machine, Engine & engine )
+            {
+                return extendedTransfer( machine, engine, Operation::Seek );
+            }
+            
+            bool getDriveParameters( const Machine & machine, Engine & engine )
+            {
+                uint8_t            driveNumber( engine.dl() );
+                uint64_t           destination( Engine::getAddress( engine.ds(), engine.si() ) );
+                const FAT::Image & image( machine.bootImage() );
+                FAT::MBR           mbr( image.mbr() );
+                
+                machine.ui().debug() << "Getting parameters for drive " << String::toHex( driveNumber ) << std::endl;
+                
+                if( driveNumber != 0x00 || mbr.bytesPerSector() == 0 )
+                {
+                    goto error;
+                }
+                
+                {
+                    BinaryDataStream stream( engine.read( destination, 2 ) );
+                    
+                    if( stream.ReadLittleEndianUInt16() < 0x1A )
+                    {
+                        goto error;
+                    }
+                }
+                
+                {
+                    std::vector< uint8_t > data;
+                    uint64_t               heads( mbr.headsPerCylinder() );
+                    uint64_t               sectorsPerTrack( mbr.sectorsPerTrack() );
+                    uint64_t               sectors( image.size() / mbr.bytesPerSector() );
+                    uint64_t               cylinders( ( heads * sectorsPerTrack > 0 ) ? sectors / ( heads * sectorsPerTrack ) : 0 );
+                    
+                    Bytes::appendLittleEndian( data, 0x1A,                 2 );
+                    Bytes::appendLittleEndian( data, 0x02,                 2 );
+                    Bytes::appendLittleEndian( data, cylinders,            4 );
+                    Bytes::appendLittleEndian( data, heads,                4 );
+                    Bytes::appendLittleEndian( data, sectorsPerTrack,      4 );
+                    Bytes::appendLittleEndian( data, sectors,              8 );
+                    Bytes::appendLittleEndian( data, mbr.bytesPerSector(), 2 );
+                    
+                    engine.write( destination, data );
+                    
+                    machine.ui().debug() << "[ SUCCESS ]> Wrote "
+                                         << data.size()
+                                         << " bytes at "
+                                         << String::toHex( destination )
+                                         << " -> "
+                                         << String::toHex( destination + data.size() )
+                                         << std::endl;
+                }
+                
+                engine.cf( false );
+                engine.ah( 0 );
+                
+                return true;
+                
+                error:
+                    
+                    engine.cf( true );
+                    engine.ah( 1 );
+                    
+                    return true;
+            }
+            
+            static bool extendedTransfer( Machine & machine, Engine & engine, Operation operation )
+            {
+                uint8_t            driveNumber( engine.dl() );
+                uint64_t           packet( Engine::getAddress( engine.ds(), engine.si() ) );
+                FAT::Image       & image( machine.bootImage() );
+                uint64_t           bytesPerSector( image.mbr().bytesPerSector() );
+                uint8_t            packetSize;
+                uint16_t           sectors;
+                uint16_t           offset;
+                uint16_t           segment;
+                uint64_t           lba;
+                uint64_t           buffer;
+                uint8_t            status( 1 );
+                
+                if( driveNumber != 0x00 )
+                {
+                    machine.ui().debug() << "[ ERROR ]> Accessing drive " << String::toHex( driveNumber ) << " is not supported" << std::endl;
+                    
+                    goto error;
+                }
+                
+                {
+                    BinaryDataStream stream( engine.read( packet, 0x10 ) );
+                    
+                    packetSize = stream.ReadUInt8();
+                    
+                    stream.ReadUInt8();
+                    
+                    sectors = stream.ReadLittleEndianUInt16();
+                    offset  = stream.ReadLittleEndianUInt16();
+                    segment = stream.ReadLittleEndianUInt16();
+                    lba     = stream.ReadLittleEndianUInt64();
+                }
+                
+                if( packetSize < 0x10 )
+                {
+                    machine.ui().debug() << "[ ERROR ]> Invalid disk address packet size: " << String::toHex( packetSize ) << std::endl;
+                    
+                    goto error;
+                }
+                
+                /*
+                 * A FFFF:FFFF transfer buffer means the 64 bits flat address
+                 * following the packet is used instead.
+                 */
+                if( packetSize >= 0x18 && segment == 0xFFFF && offset == 0xFFFF )
+                {
+                    BinaryDataStream stream( engine.read( packet + 0x10, 0x08 ) );
+                    
+                    buffer = stream.ReadLittleEndianUInt64();
+                }
+                else
+                {
+                    buffer = Engine::getAddress( segment, offset );
+                }
+                
+                switch( operation )
+                {
+                    case Operation::Read:   machine.ui().debug() << "Reading "   << sectors << " sector" << ( ( sectors > 1 ) ? "s" : "" ) << " from drive " << String::toHex( driveNumber ); break;
+                    case Operation::Write:  machine.ui().debug() << "Writing "   << sectors << " sector" << ( ( sectors > 1 ) ? "s" : "" ) << " to drive "   << String::toHex( driveNumber ); break;
+                    case Operation::Verify: machine.ui().debug() << "Verifying " << sectors << " sector" << ( ( sectors > 1 ) ? "s" : "" ) << " on drive "   << String::toHex( driveNumber ); break;
+                    case Operation::Seek:   machine.ui().debug() << "Seeking on drive " << String::toHex( driveNumber );                                                                 break;
+                }
+                
+                machine.ui().debug() << std::endl
+                                     << "    - Packet:      " << String::toHex( packet ) << " (" << String::toHex( engine.ds() ) << ":" << String::toHex( engine.si() ) << ")"
+                                     << std::endl
+                                     << "    - LBA:         " << String::toHex( lba )
+                                     << std::endl
+                                     << "    - Buffer:      " << String::toHex( buffer )
+                                     << std::endl;
+                
+                if( bytesPerSector == 0 || ( sectors == 0 && operation != Operation::Seek ) )
+                {
+                    machine.ui().debug() << "[ ERROR ]> No data received" << std::endl;
+                    
+                    goto error;
+                }
+                
+                /*
+                 * A seek ignores the block count, so only its LBA has to be
+                 * on the disk.
+                 */
+                if( lba >= image.size() / bytesPerSector || ( operation != Operation::Seek && sectors > ( image.size() / bytesPerSector ) - lba ) )
+                {
+                    machine.ui().debug() << "[ ERROR ]> Sectors out of range" << std::endl;
+                    
+                    status = 4;
+                    
+                    goto error;
+                }
+                
+                /*
+                 * The image has no media errors and no heads to move, so
+                 * verifying and seeking succeed once the range is valid.
+                 */
+                if( operation == Operation::Verify || operation == Operation::Seek )
+                {
+                    machine.ui().debug() << "[ SUCCESS ]> Range is valid" << std::endl;
+                    
+                    engine.cf( false );
+                    engine.ah( 0 );
+                    
+                    return true;
+                }
+                
+                {
+                    size_t size( numeric_cast< size_t >( sectors * bytesPerSector ) );
+                    
+                    /*
+                     * The exceptions thrown by the engine would abort the
+                     * emulation, so a buffer past the end of guest memory
+                     * is reported to the caller instead.
+                     */
+                    if( buffer > engine.memory() || size > engine.memory() - buffer )
+                    {
+                        machine.ui().debug() << "[ ERROR ]> Buffer out of memory" << std::endl;
+                        
+                        status = 4;
+                        
+                        goto error;
+                    }
+                    
+                    if( operation == Operation::Write )
+                    {
+                        image.write( lba * bytesPerSector, engine.view( buffer, size ), size );
+                    }
+                    else
+                    {
+                        image.read
+                        (
+                            lba * bytesPerSector,
+                            size,
+                            [ & ]( uint64_t position, const uint8_t * bytes, size_t length )
+                            {
+                                engine.write( buffer + position, bytes, length );
+                            }
+                        );
+                    }
+                    
+                    machine.ui().debug() << "[ SUCCESS ]> Transferred "
+                                         << size
+                                         << " bytes at "
+                                         << String::toHex( buffer )
+                                         << " -> "
+                                         << String::toHex( buffer + size )
+                                         << std::endl;
+                    
+                    engine.cf( false );
+                    engine.ah( 0 );
+                    
+                    return true;
+                }
+                
+                error:
+                    
+                    /*
+                     * The packet's block count holds the number of
+                     * transferred sectors.
+                     */
+                    {
+                        std::vector< uint8_t > count;
+                        
+                        Bytes::appendLittleEndian( count, 0, 2 );
+                        engine.write( packet + 2, count );
+                    }
+                    
+                    engine.cf( true );
+                    engine.ah( status );
+                    
+                    return true;
+            }
         }
     }
 }
@@ -36,6 +36,13 @@ namespace UB
         {
             bool reset( const Machine & machine, Engine & engine );
             bool readSectors( const Machine & machine, Engine & engine );
+            bool writeSectors( Machine & machine, Engine & engine );
+            bool checkExtensions( const Machine & machine, Engine & engine );
+            bool extendedReadSectors( Machine & machine, Engine & engine );
+            bool extendedWriteSectors( Machine & machine, Engine & engine );
+            bool verifySectors( Machine & machine, Engine & engine );
+            bool extendedSeek( Machine & machine, Engine & engine );
+            bool getDriveParameters( const Machine & machine, Engine & engine );
         }
     }
 }
@@ -61,7 +61,7 @@ namespace UB
             return *( this );
         }
 
-        std::vector< MemoryMap::Entry > MemoryMap::entries( void ) const
+        const std::vector< MemoryMap::Entry > & MemoryMap::entries( void ) const
         {
             return this->impl->_entries;
         }
@@ -86,8 +86,12 @@ namespace UB
             free  = memory - 0x00100000 - 0x00010000;
             after = memory - 0x00010000;
             
-            this->_entries.push_back( { 0x00000000, 0x0009FC00, Entry::Type::Usable } );
-            this->_entries.push_back( { 0x0009FC00, 0x00000400, Entry::Type::Reserved } );
+            /*
+             * The EBDA is reported as a whole page, so it can be protected
+             * by the engine.
+             */
+            this->_entries.push_back( { 0x00000000, 0x0009F000, Entry::Type::Usable } );
+            this->_entries.push_back( { 0x0009F000, 0x00001000, Entry::Type::Reserved } );
             this->_entries.push_back( { 0x000F0000, 0x00010000, Entry::Type::Reserved } );
             this->_entries.push_back( { 0x00100000, free,       Entry::Type::Usable } );
             this->_entries.push_back( { after,      0x00010000, Entry::Type::ACPI } );
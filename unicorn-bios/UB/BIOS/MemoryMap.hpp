@@ -83,7 +83,7 @@ namespace UB
                 
                 MemoryMap & operator =( MemoryMap o );
                 
-                std::vector< Entry > entries( void ) const;
+                const std::vector< Entry > & entries( void ) const;
                 
                 friend void swap( MemoryMap & o1, MemoryMap & o2 );
                 
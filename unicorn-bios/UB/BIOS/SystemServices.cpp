@@ -35,12 +35,12 @@ namespace UB
         {
             bool getMemoryMap( const Machine & machine, Engine & engine )
             {
-                uint64_t                        destination( Engine::getAddress( engine.es(), engine.di() ) );
-                uint32_t                        index( engine.ebx() );
-                uint32_t                        size( engine.ecx() );
-                uint32_t                        signature( engine.edx() );
-                const MemoryMap               & map( machine.memoryMap() );
-                std::vector< MemoryMap::Entry > entries( map.entries() );
+                uint64_t                                destination( Engine::getAddress( engine.es(), engine.di() ) );
+                uint32_t                                index( engine.ebx() );
+                uint32_t                                size( engine.ecx() );
+                uint32_t                                signature( engine.edx() );
+                const MemoryMap                       & map( machine.memoryMap() );
+                const std::vector< MemoryMap::Entry > & entries( map.entries() );
                 
                 machine.ui().debug() << "Getting memory map:"
                                      << std::endl
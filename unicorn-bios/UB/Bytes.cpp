@@ -0,0 +1,51 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "UB/Bytes.hpp"
+#include "UB/Casts.hpp"
+#include <limits>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace UB
+{
+    namespace Bytes
+    {
+        void appendLittleEndian( std::vector< uint8_t > & data, uint64_t value, size_t size )
+        {
+            for( size_t i = 0; i < size; i++ )
+            {
+                data.push_back( static_cast< uint8_t >( value >> ( i * 8 ) ) );
+            }
+        }
+        
+        void readAll( int fd, uint8_t * buffer, size_t size, uint64_t offset, const std::string & path )
+        {
+            if( pread( fd, buffer, size, numeric_cast< off_t >( offset ) ) != numeric_cast< ssize_t >( size ) )
+            {
+                throw std::runtime_error( "Cannot read file: " + path );
+            }
+        }
+    }
+}
@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef UB_BYTES_HPP
+#define UB_BYTES_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace UB
+{
+    /*
+     * Helpers for binary file formats. All values are little endian, and
+     * sizes are in bytes (up to 8).
+     */
+    namespace Bytes
+    {
+        void appendLittleEndian( std::vector< uint8_t > & data, uint64_t value, size_t size );
+        
+        /*
+         * Reads exactly the given number of bytes at an offset of a file,
+         * or throws.
+         */
+        void readAll( int fd, uint8_t * buffer, size_t size, uint64_t offset, const std::string & path );
+        
+        /*
+         * Used by hooks, so they're defined here to be inlined.
+         * Returns the number of bytes written.
+         */
+        inline size_t putLittleEndian( uint8_t * data, uint64_t value, size_t size )
+        {
+            for( size_t i = 0; i < size; i++ )
+            {
+                data[ i ] = static_cast< uint8_t >( value >> ( i * 8 ) );
+            }
+            
+            return size;
+        }
+        
+        inline uint64_t getLittleEndian( const uint8_t * data, size_t size )
+        {
+            uint64_t value( 0 );
+            
+            for( size_t i = 0; i < size; i++ )
+            {
+                value |= static_cast< uint64_t >( data[ i ] ) << ( i * 8 );
+            }
+            
+            return value;
+        }
+    }
+}
+
+#endif /* UB_BYTES_HPP */
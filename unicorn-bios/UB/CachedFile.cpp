@@ -0,0 +1,239 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#include "UB/CachedFile.hpp"
+#include "UB/Casts.hpp"
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace UB
+{
+    class CachedFile::IMPL
+    {
+        public:
+            
+            class Block
+            {
+                public:
+                    
+                    uint64_t               index;
+                    std::vector< uint8_t > data;
+            };
+            
+            IMPL( const std::string & path, size_t cacheSize );
+            ~IMPL( void );
+            
+            const std::vector< uint8_t > & _block( uint64_t index );
+            void                           _load( uint64_t index, size_t count );
+            
+            std::string                                                   _path;
+            int                                                           _fd;
+            size_t                                                        _size;
+            size_t                                                        _capacity;
+            uint64_t                                                      _next;
+            std::list< Block >                                            _blocks;
+            std::unordered_map< uint64_t, std::list< Block >::iterator > _index;
+            std::mutex                                                    _mtx;
+    };
+    
+    CachedFile::CachedFile( const std::string & path, size_t cacheSize ):
+        impl( std::make_unique< IMPL >( path, cacheSize ) )
+    {}
+    
+    CachedFile::~CachedFile( void )
+    {}
+    
+    std::string CachedFile::path( void ) const
+    {
+        return this->impl->_path;
+    }
+    
+    size_t CachedFile::size( void ) const
+    {
+        return this->impl->_size;
+    }
+    
+    void CachedFile::read( uint64_t offset, size_t size, const std::function< void( uint64_t, const uint8_t *, size_t ) > & handler ) const
+    {
+        std::lock_guard< std::mutex > l( this->impl->_mtx );
+        uint64_t                      position( 0 );
+        uint64_t                      first( offset / BlockSize );
+        uint64_t                      blocks( ( this->impl->_size + BlockSize - 1 ) / BlockSize );
+        
+        if( offset > this->impl->_size || size > this->impl->_size - offset )
+        {
+            throw std::runtime_error( "Invalid read - Not enough data available" );
+        }
+        
+        if( size == 0 )
+        {
+            return;
+        }
+        
+        /*
+         * Reads starting where the previous one ended are considered
+         * sequential - When one of the requested blocks, or one of the
+         * following ones, is missing, it's loaded along with the next ones,
+         * using a single system call.
+         */
+        if( first == this->impl->_next || first + 1 == this->impl->_next )
+        {
+            uint64_t last( ( offset + size - 1 ) / BlockSize );
+            uint64_t index( first );
+            
+            while( index <= last + ReadAhead && index < blocks && this->impl->_index.count( index ) > 0 )
+            {
+                index++;
+            }
+            
+            if( index <= last + ReadAhead && index < blocks )
+            {
+                this->impl->_load( index, numeric_cast< size_t >( std::min( std::max( last + 1, index ) + ReadAhead, blocks ) - index ) );
+            }
+        }
+        
+        while( position < size )
+        {
+            uint64_t                       index( ( offset + position ) / BlockSize );
+            uint64_t                       start( ( offset + position ) % BlockSize );
+            size_t                         length( numeric_cast< size_t >( std::min< uint64_t >( BlockSize - start, size - position ) ) );
+            const std::vector< uint8_t > & block( this->impl->_block( index ) );
+            
+            handler( position, block.data() + start, length );
+            
+            position += length;
+        }
+        
+        this->impl->_next = ( offset + size + BlockSize - 1 ) / BlockSize;
+    }
+    
+    CachedFile::IMPL::IMPL( const std::string & path, size_t cacheSize ):
+        _path(     path ),
+        _fd(       -1 ),
+        _size(     0 ),
+        _capacity( std::max( cacheSize / BlockSize, ReadAhead * 2 ) ),
+        _next(     0 )
+    {
+        struct stat st;
+        
+        if( ( this->_fd = open( path.c_str(), O_RDONLY ) ) == -1 )
+        {
+            throw std::runtime_error( "Cannot open file: " + path );
+        }
+        
+        if( fstat( this->_fd, &st ) != 0 )
+        {
+            close( this->_fd );
+            
+            throw std::runtime_error( "Cannot get file size: " + path );
+        }
+        
+        this->_size = numeric_cast< size_t >( st.st_size );
+    }
+    
+    CachedFile::IMPL::~IMPL( void )
+    {
+        if( this->_fd != -1 )
+        {
+            close( this->_fd );
+        }
+    }
+    
+    const std::vector< uint8_t > & CachedFile::IMPL::_block( uint64_t index )
+    {
+        auto it( this->_index.find( index ) );
+        
+        if( it == this->_index.end() )
+        {
+            this->_load( index, 1 );
+            
+            it = this->_index.find( index );
+        }
+        
+        this->_blocks.splice( this->_blocks.begin(), this->_blocks, it->second );
+        
+        return it->second->data;
+    }
+    
+    void CachedFile::IMPL::_load( uint64_t index, size_t count )
+    {
+        std::vector< struct iovec >                 vectors;
+        std::vector< std::list< Block >::iterator > blocks;
+        ssize_t                                     expected( 0 );
+        
+        /*
+         * Only the leading run of missing blocks is loaded, as blocks are
+         * read contiguously.
+         */
+        while( this->_index.find( index + blocks.size() ) == this->_index.end() && blocks.size() < count && blocks.size() < this->_capacity )
+        {
+            uint64_t current( index + blocks.size() );
+            size_t   length( std::min( BlockSize, this->_size - numeric_cast< size_t >( current * BlockSize ) ) );
+            
+            if( this->_blocks.size() >= this->_capacity )
+            {
+                this->_index.erase( this->_blocks.back().index );
+                this->_blocks.splice( this->_blocks.begin(), this->_blocks, std::prev( this->_blocks.end() ) );
+            }
+            else
+            {
+                this->_blocks.emplace_front();
+            }
+            
+            this->_blocks.front().index = current;
+            
+            this->_blocks.front().data.resize( length );
+            blocks.push_back( this->_blocks.begin() );
+            vectors.push_back( { this->_blocks.front().data.data(), length } );
+            
+            this->_index[ current ] = this->_blocks.begin();
+            
+            expected += numeric_cast< ssize_t >( length );
+        }
+        
+        if( blocks.size() == 0 )
+        {
+            return;
+        }
+        
+        if( preadv( this->_fd, vectors.data(), numeric_cast< int >( vectors.size() ), numeric_cast< off_t >( index * BlockSize ) ) != expected )
+        {
+            for( const auto & block: blocks )
+            {
+                this->_index.erase( block->index );
+                this->_blocks.erase( block );
+            }
+            
+            throw std::runtime_error( "Cannot read file: " + this->_path );
+        }
+    }
+}
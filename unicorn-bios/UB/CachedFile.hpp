@@ -0,0 +1,69 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#ifndef UB_CACHED_FILE_HPP
+#define UB_CACHED_FILE_HPP
+
+#include <memory>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+#include "UB/FileStorage.hpp"
+
+namespace UB
+{
+    /*
+     * File read on demand, by blocks, with a bounded LRU cache.
+     * Sequential reads are detected, and the following blocks are read
+     * ahead, so consecutive reads are served from the cache.
+     */
+    class CachedFile: public FileStorage
+    {
+        public:
+            
+            static constexpr size_t BlockSize = 64 * 1024;
+            static constexpr size_t ReadAhead = 4;
+            
+            CachedFile( const std::string & path, size_t cacheSize );
+            ~CachedFile( void ) override;
+            
+            CachedFile( const CachedFile & o )              = delete;
+            CachedFile( CachedFile && o )                   = delete;
+            CachedFile & operator =( const CachedFile & o ) = delete;
+            CachedFile & operator =( CachedFile && o )      = delete;
+            
+            std::string path( void ) const override;
+            size_t      size( void ) const override;
+            
+            void read( uint64_t offset, size_t size, const std::function< void( uint64_t, const uint8_t *, size_t ) > & handler ) const override;
+            
+        private:
+            
+            class IMPL;
+            std::unique_ptr< IMPL > impl;
+    };
+}
+
+#endif /* UB_CACHED_FILE_HPP */
@@ -42,6 +42,16 @@ namespace UB
     namespace Capstone
     {
         std::vector< std::pair< std::string, std::string > > disassemble( const std::vector< uint8_t > & data, uint64_t org )
+        {
+            return disassemble( data.data(), data.size(), org );
+        }
+        
+        std::vector< std::pair< std::string, std::string > > instructions( const std::vector< uint8_t > & data, uint64_t org )
+        {
+            return instructions( data.data(), data.size(), org );
+        }
+        
+        std::vector< std::pair< std::string, std::string > > disassemble( const uint8_t * data, size_t size, uint64_t org )
         {
             csh       handle;
             cs_insn * instruction;
@@ -54,7 +64,7 @@ namespace UB
                 return {};
             }
             
-            count = cs_disasm( handle, &( data[ 0 ] ), data.size(), org, 0, &instruction );
+            count = cs_disasm( handle, data, size, org, 0, &instruction );
             
             if( count == 0 )
             {
@@ -80,7 +90,7 @@ namespace UB
             return v;
         }
         
-        std::vector< std::pair< std::string, std::string > > instructions( const std::vector< uint8_t > & data, uint64_t org )
+        std::vector< std::pair< std::string, std::string > > instructions( const uint8_t * data, size_t size, uint64_t org )
         {
             csh       handle;
             cs_insn * instruction;
@@ -93,7 +103,7 @@ namespace UB
                 return {};
             }
             
-            count = cs_disasm( handle, &( data[ 0 ] ), data.size(), org, 0, &instruction );
+            count = cs_disasm( handle, data, size, org, 0, &instruction );
             
             if( count == 0 )
             {
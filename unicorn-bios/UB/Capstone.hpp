@@ -35,6 +35,8 @@ namespace UB
     {
         std::vector< std::pair< std::string, std::string > > disassemble(  const std::vector< uint8_t > & data, uint64_t org );
         std::vector< std::pair< std::string, std::string > > instructions( const std::vector< uint8_t > & data, uint64_t org );
+        std::vector< std::pair< std::string, std::string > > disassemble(  const uint8_t * data, size_t size, uint64_t org );
+        std::vector< std::pair< std::string, std::string > > instructions( const uint8_t * data, size_t size, uint64_t org );
     }
 }
 
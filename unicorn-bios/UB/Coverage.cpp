@@ -0,0 +1,212 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "UB/Coverage.hpp"
+#include "UB/Engine.hpp"
+#include "UB/String.hpp"
+#include <array>
+#include <algorithm>
+#include <optional>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace UB
+{
+    class Coverage::IMPL
+    {
+        public:
+            
+            static constexpr uint64_t PageSize = 4096;
+            
+            using Page = std::array< uint64_t, PageSize / 64 >;
+            
+            IMPL( Engine & engine );
+            ~IMPL( void );
+            
+            void _record( uint64_t address, size_t size );
+            void _stop( void );
+            
+            Engine                               & _engine;
+            std::optional< uint64_t >              _handler;
+            std::vector< std::unique_ptr< Page > > _pages;
+            std::vector< Block >                   _blocks;
+            uint64_t                               _bytes;
+    };
+    
+    Coverage::Coverage( Engine & engine ):
+        impl( std::make_unique< IMPL >( engine ) )
+    {}
+    
+    Coverage::~Coverage( void )
+    {}
+    
+    void Coverage::stop( void )
+    {
+        this->impl->_stop();
+    }
+    
+    const std::vector< Coverage::Block > & Coverage::blocks( void ) const
+    {
+        return this->impl->_blocks;
+    }
+    
+    uint64_t Coverage::bytes( void ) const
+    {
+        return this->impl->_bytes;
+    }
+    
+    void Coverage::drcov( const std::string & path, const std::string & module ) const
+    {
+        std::ofstream stream( path, std::ios::out | std::ios::binary | std::ios::trunc );
+        uint64_t      end( this->impl->_pages.size() * IMPL::PageSize );
+        
+        if( stream.is_open() == false )
+        {
+            throw std::runtime_error( "Cannot open coverage file: " + path );
+        }
+        
+        stream << "DRCOV VERSION: 2\n"
+               << "DRCOV FLAVOR: unicorn-bios\n"
+               << "Module Table: version 2, count 1\n"
+               << "Columns: id, base, end, entry, checksum, timestamp, path\n"
+               << " 0, " << String::toHex( uint64_t( 0 ) ) << ", " << String::toHex( end ) << ", " << String::toHex( uint64_t( 0 ) ) << ", " << String::toHex( uint32_t( 0 ) ) << ", " << String::toHex( uint32_t( 0 ) ) << ", " << module << "\n"
+               << "BB Table: " << this->impl->_blocks.size() << " bbs\n";
+        
+        /*
+         * Binary entries: offset from the module base (4 bytes), size
+         * (2 bytes) and module ID (2 bytes), little endian.
+         */
+        for( const auto & block: this->impl->_blocks )
+        {
+            uint8_t entry[ 8 ] =
+            {
+                static_cast< uint8_t >( block.address ),
+                static_cast< uint8_t >( block.address >> 8 ),
+                static_cast< uint8_t >( block.address >> 16 ),
+                static_cast< uint8_t >( block.address >> 24 ),
+                static_cast< uint8_t >( block.size ),
+                static_cast< uint8_t >( block.size >> 8 ),
+                0,
+                0
+            };
+            
+            stream.write( reinterpret_cast< const char * >( entry ), sizeof( entry ) );
+        }
+        
+        if( stream.good() == false )
+        {
+            throw std::runtime_error( "Cannot write coverage file: " + path );
+        }
+    }
+    
+    void Coverage::list( const std::string & path ) const
+    {
+        std::ofstream stream( path, std::ios::out | std::ios::trunc );
+        
+        if( stream.is_open() == false )
+        {
+            throw std::runtime_error( "Cannot open coverage file: " + path );
+        }
+        
+        for( const auto & block: this->impl->_blocks )
+        {
+            stream << String::toHex( block.address ) << " " << block.size << "\n";
+        }
+        
+        if( stream.good() == false )
+        {
+            throw std::runtime_error( "Cannot write coverage file: " + path );
+        }
+    }
+    
+    Coverage::IMPL::IMPL( Engine & engine ):
+        _engine( engine ),
+        _bytes(  0 )
+    {
+        this->_handler = this->_engine.onBlock
+        (
+            [ this ]( uint64_t address, size_t size )
+            {
+                this->_record( address, size );
+            }
+        );
+    }
+    
+    Coverage::IMPL::~IMPL( void )
+    {
+        this->_stop();
+    }
+    
+    void Coverage::IMPL::_stop( void )
+    {
+        if( this->_handler.has_value() )
+        {
+            this->_engine.removeBlockHandler( this->_handler.value() );
+            this->_handler.reset();
+        }
+    }
+    
+    /*
+     * Called by the emulation thread for every executed block.
+     * Pages are only allocated when a block is first seen in them, so
+     * already known blocks are found with a single bit test.
+     */
+    void Coverage::IMPL::_record( uint64_t address, size_t size )
+    {
+        uint64_t page( address / PageSize );
+        uint64_t offset( address % PageSize );
+        uint64_t bit( uint64_t( 1 ) << ( offset % 64 ) );
+        
+        if( address > std::numeric_limits< uint32_t >::max() )
+        {
+            return;
+        }
+        
+        if( page >= this->_pages.size() )
+        {
+            this->_pages.resize( page + 1 );
+        }
+        
+        if( this->_pages[ page ] == nullptr )
+        {
+            this->_pages[ page ] = std::make_unique< Page >();
+            
+            this->_pages[ page ]->fill( 0 );
+        }
+        
+        if( ( *( this->_pages[ page ] ) )[ offset / 64 ] & bit )
+        {
+            return;
+        }
+        
+        ( *( this->_pages[ page ] ) )[ offset / 64 ] |= bit;
+        
+        size = std::min< size_t >( size, std::numeric_limits< uint16_t >::max() );
+        
+        this->_blocks.push_back( { static_cast< uint32_t >( address ), static_cast< uint16_t >( size ) } );
+        
+        this->_bytes += size;
+    }
+}
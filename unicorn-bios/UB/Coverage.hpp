@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef UB_COVERAGE_HPP
+#define UB_COVERAGE_HPP
+
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <vector>
+
+namespace UB
+{
+    class Engine;
+    
+    /*
+     * Collects the basic blocks executed by an engine.
+     * 
+     * Blocks are reported once per execution by the engine's block hook, so
+     * collecting coverage is cheap enough to be always enabled.
+     * Known block addresses are kept in a bitmap per 4KB page of guest
+     * memory, so the hook only records a block the first time it's seen.
+     * Addresses are linear.
+     */
+    class Coverage
+    {
+        public:
+            
+            class Block
+            {
+                public:
+                    
+                    uint32_t address;
+                    uint16_t size;
+            };
+            
+            Coverage( Engine & engine );
+            ~Coverage( void );
+            
+            Coverage( const Coverage & o )              = delete;
+            Coverage( Coverage && o )                   = delete;
+            Coverage & operator =( const Coverage & o ) = delete;
+            Coverage & operator =( Coverage && o )      = delete;
+            
+            /*
+             * Stops collecting. Must be called before reading the blocks
+             * while the emulation is running.
+             */
+            void stop( void );
+            
+            /*
+             * Blocks, in execution order.
+             */
+            const std::vector< Block > & blocks( void ) const;
+            uint64_t                     bytes( void )  const;
+            
+            /*
+             * Writes a drcov (version 2) file, for use with coverage tools
+             * like Lighthouse.
+             * All blocks are reported as part of a single module covering
+             * guest memory, with the given name.
+             */
+            void drcov( const std::string & path, const std::string & module ) const;
+            
+            /*
+             * Writes one block per line: hexadecimal address and size.
+             */
+            void list( const std::string & path ) const;
+            
+        private:
+            
+            class IMPL;
+            std::unique_ptr< IMPL > impl;
+    };
+}
+
+#endif /* UB_COVERAGE_HPP */
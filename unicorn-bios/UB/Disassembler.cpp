@@ -0,0 +1,190 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#include "UB/Disassembler.hpp"
+#include <unordered_map>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdocumentation"
+#pragma clang diagnostic ignored "-Wnested-anon-types"
+#endif
+#include <capstone/capstone.h>
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+namespace UB
+{
+    class Disassembler::IMPL
+    {
+        public:
+            
+            static constexpr size_t MaxCacheEntries = 4096;
+            
+            IMPL( void );
+            IMPL( const IMPL & o );
+            ~IMPL( void );
+            
+            const Instruction * _decode( const uint8_t * data, size_t size, uint64_t address );
+            
+            csh                                         _handle;
+            cs_insn                                   * _instruction;
+            std::unordered_map< uint64_t, Instruction > _cache;
+            std::vector< Instruction >                  _instructions;
+    };
+    
+    Disassembler::Disassembler( void ):
+        impl( std::make_unique< IMPL >() )
+    {}
+    
+    Disassembler::Disassembler( const Disassembler & o ):
+        impl( std::make_unique< IMPL >( *( o.impl ) ) )
+    {}
+    
+    Disassembler::Disassembler( Disassembler && o ) noexcept:
+        impl( std::move( o.impl ) )
+    {}
+    
+    Disassembler::~Disassembler( void )
+    {}
+    
+    Disassembler & Disassembler::operator =( Disassembler o )
+    {
+        swap( *( this ), o );
+        
+        return *( this );
+    }
+    
+    const std::vector< Disassembler::Instruction > & Disassembler::disassemble( const uint8_t * data, size_t size, uint64_t address, size_t count )
+    {
+        size_t offset( 0 );
+        
+        this->impl->_instructions.clear();
+        
+        while( this->impl->_instructions.size() < count && offset < size )
+        {
+            const Instruction * instruction( this->impl->_decode( data + offset, size - offset, address + offset ) );
+            
+            if( instruction == nullptr )
+            {
+                break;
+            }
+            
+            this->impl->_instructions.push_back( *( instruction ) );
+            
+            offset += instruction->bytes.size();
+        }
+        
+        return this->impl->_instructions;
+    }
+    
+    void swap( Disassembler & o1, Disassembler & o2 )
+    {
+        using std::swap;
+        
+        swap( o1.impl, o2.impl );
+    }
+    
+    Disassembler::IMPL::IMPL( void ):
+        _handle(      0 ),
+        _instruction( nullptr )
+    {
+        if( cs_open( CS_ARCH_X86, CS_MODE_16, &( this->_handle ) ) != CS_ERR_OK )
+        {
+            throw std::runtime_error( "Cannot initialize disassembler" );
+        }
+        
+        if( ( this->_instruction = cs_malloc( this->_handle ) ) == nullptr )
+        {
+            cs_close( &( this->_handle ) );
+            
+            throw std::runtime_error( "Cannot initialize disassembler" );
+        }
+    }
+    
+    /*
+     * Copies use their own handle, and start with an empty cache.
+     */
+    Disassembler::IMPL::IMPL( const IMPL & o ):
+        IMPL()
+    {
+        ( void )o;
+    }
+    
+    Disassembler::IMPL::~IMPL( void )
+    {
+        if( this->_instruction != nullptr )
+        {
+            cs_free( this->_instruction, 1 );
+        }
+        
+        cs_close( &( this->_handle ) );
+    }
+    
+    const Disassembler::Instruction * Disassembler::IMPL::_decode( const uint8_t * data, size_t size, uint64_t address )
+    {
+        {
+            auto it( this->_cache.find( address ) );
+            
+            if( it != this->_cache.end() )
+            {
+                const std::vector< uint8_t > & bytes( it->second.bytes );
+                
+                if( bytes.size() <= size && memcmp( bytes.data(), data, bytes.size() ) == 0 )
+                {
+                    return &( it->second );
+                }
+                
+                this->_cache.erase( it );
+            }
+        }
+        
+        {
+            const uint8_t * code( data );
+            uint64_t        pc( address );
+            Instruction     instruction;
+            
+            if( cs_disasm_iter( this->_handle, &code, &size, &pc, this->_instruction ) == false )
+            {
+                return nullptr;
+            }
+            
+            instruction.address  = address;
+            instruction.bytes    = std::vector< uint8_t >( data, data + this->_instruction->size );
+            instruction.mnemonic = this->_instruction->mnemonic;
+            instruction.operands = this->_instruction->op_str;
+            
+            if( this->_cache.size() >= MaxCacheEntries )
+            {
+                this->_cache.clear();
+            }
+            
+            return &( this->_cache[ address ] = std::move( instruction ) );
+        }
+    }
+}
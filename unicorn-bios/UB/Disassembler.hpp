@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#ifndef UB_DISASSEMBLER_HPP
+#define UB_DISASSEMBLER_HPP
+
+#include <memory>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+#include <vector>
+
+namespace UB
+{
+    /*
+     * Long-lived 16 bits x86 disassembler.
+     * Decoded instructions are cached by linear address, and cache entries
+     * are only reused as long as the instruction's bytes are unchanged, so
+     * writes to memory are taken into account.
+     * Not thread-safe.
+     */
+    class Disassembler
+    {
+        public:
+            
+            class Instruction
+            {
+                public:
+                    
+                    uint64_t               address;
+                    std::vector< uint8_t > bytes;
+                    std::string            mnemonic;
+                    std::string            operands;
+            };
+            
+            Disassembler( void );
+            Disassembler( const Disassembler & o );
+            Disassembler( Disassembler && o ) noexcept;
+            ~Disassembler( void );
+            
+            Disassembler & operator =( Disassembler o );
+            
+            /*
+             * Decodes at most count instructions, starting at the given
+             * address, from data.
+             * References are valid until the next call.
+             */
+            const std::vector< Instruction > & disassemble( const uint8_t * data, size_t size, uint64_t address, size_t count );
+            
+            friend void swap( Disassembler & o1, Disassembler & o2 );
+            
+        private:
+            
+            class IMPL;
+            std::unique_ptr< IMPL > impl;
+    };
+}
+
+#endif /* UB_DISASSEMBLER_HPP */
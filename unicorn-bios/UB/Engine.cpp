@@ -32,10 +32,17 @@
 #include "UB/Casts.hpp"
 #include <unicorn/unicorn.h>
 #include <map>
+#include <cstring>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
 #include <limits>
+#include <atomic>
+#include <optional>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace UB
 {
@@ -43,34 +50,142 @@ namespace UB
     {
         public:
             
-            IMPL( size_t memory );
+            IMPL( Engine & engine, size_t memory, const std::string & memoryFile );
             ~IMPL( void );
             
             static void _handleInterrupt(   uc_engine * uc, uint32_t i, void * data );
             static void _handleInstruction( uc_engine * uc, uint64_t address, uint32_t size, void * data );
+            static void _handleExecute(     uc_engine * uc, uint64_t address, uint32_t size, void * data );
             static bool _handleInvalidMemoryAccess( uc_engine * uc, uc_mem_type type, uint64_t address, int size, int64_t value, void * data );
             static void _handleValidMemoryAccess( uc_engine * uc, uc_mem_type type, uint64_t address, int size, int64_t value, void * data );
+            static void _handleMemoryWrite( uc_engine * uc, uc_mem_type type, uint64_t address, int size, int64_t value, void * data );
+            static void _handleBlock(       uc_engine * uc, uint64_t address, uint32_t size, void * data );
             
-            std::vector< uint8_t > _read( size_t address, size_t size );
+            const uint8_t        * _view( size_t address, size_t size ) const;
+            std::vector< uint8_t > _read( size_t address, size_t size ) const;
+            void                   _read( size_t address, uint8_t * bytes, size_t size ) const;
             void                   _write( size_t address, const uint8_t * bytes, size_t size );
             
+            bool _needsInstructionHook( void ) const;
+            bool _hooksChanged( void ) const;
+            void _updateHooks( void );
+            void _applyHooks( void );
+            void _markTranslated( uint64_t address, size_t size );
+            void _publishRegisters( void );
+            void _invalidateTranslations( size_t address, size_t size );
+            void _snapshot( RegisterFile & file ) const;
+            void _close( void );
+            
+            /*
+             * Maximum length of an x86 instruction.
+             * Instruction buffers are reserved with this capacity, so the
+             * instruction hook never needs to allocate.
+             */
+            static constexpr size_t MaxInstructionSize = 15;
+            
+            /*
+             * Granularity of the translated code tracking.
+             */
+            static constexpr size_t PageSize = 4096;
+            
+            using BeforeInstructionHandlers = std::vector< std::pair< uint64_t, std::function< void( uint64_t, const std::vector< uint8_t > & ) > > >;
+            using AfterInstructionHandlers  = std::vector< std::pair< uint64_t, std::function< void( uint64_t, const Registers &, const std::vector< uint8_t > & ) > > >;
+            using MemoryWriteHandlers       = std::vector< std::pair< uint64_t, std::function< void( uint64_t, size_t, uint64_t ) > > >;
+            using BlockHandlers             = std::vector< std::pair< uint64_t, std::function< void( uint64_t, size_t ) > > >;
+            
+            /*
+             * Execute handlers are backed by their own code hook, limited to
+             * an address range, so instructions outside that range don't pay
+             * anything for them.
+             */
+            class ExecuteHandler
+            {
+                public:
+                    
+                    IMPL                                    * impl;
+                    uint64_t                                  begin;
+                    uint64_t                                  end;
+                    std::function< void( uint64_t, size_t ) > handler;
+                    uc_hook                                   hook;
+                    bool                                      installed;
+                    std::atomic< bool >                       removed;
+                    std::optional< uint64_t >                 skip;
+            };
+            
+            Engine                     & _engine;
             size_t                       _memory;
+            uint8_t                    * _ram;
+            int                          _ramFile;
             Registers                    _registers;
+            Registers                    _lastRegisters;
+            mutable std::mutex           _registersMutex;
+            uint64_t                     _instructionAddress;
             uint64_t                     _lastInstructionAddress;
+            std::vector< uint8_t >       _instruction;
             std::vector< uint8_t >       _lastInstruction;
             uc_engine                  * _uc;
-            bool                         _running;
+            uc_hook                      _instructionHook;
+            uc_hook                      _validMemoryHook;
+            uc_hook                      _memoryWriteHook;
+            uc_hook                      _blockHook;
+            bool                         _instructionHookInstalled;
+            bool                         _validMemoryHookInstalled;
+            bool                         _memoryWriteHookInstalled;
+            std::atomic< bool >          _running;
+            std::atomic< bool >          _restart;
+            std::atomic< bool >          _stopRequested;
+            std::atomic< bool >          _registersRequested;
+            std::vector< bool >          _translatedPages;
+            bool                         _executeHandlersChanged;
+            uint64_t                     _nextHandlerID;
+            std::thread::id              _emulationThread;
+            std::optional< uint64_t >    _hookAddress;
+            std::optional< uint64_t >    _resumeAddress;
+            std::optional< uint64_t >    _skipInstruction;
             mutable std::recursive_mutex _rmtx;
             std::condition_variable_any  _cv;
             
-            std::vector< std::function< void( void ) > >                                                        _onStart;
-            std::vector< std::function< void( void ) > >                                                        _onStop;
-            std::vector< std::function< bool( uint32_t ) > >                                                    _interruptHandlers;
-            std::vector< std::function< bool( const std::exception & ) > >                                      _exceptionHandlers;
-            std::vector< std::function< void( uint64_t, size_t ) > >                                            _invalidMemoryHandlers;
-            std::vector< std::function< void( uint64_t, size_t ) > >                                            _validMemoryHandlers;
-            std::vector< std::function< void( uint64_t, const std::vector< uint8_t > & ) > >                    _beforeInstructionHandlers;
-            std::vector< std::function< void( uint64_t, const Registers &, const std::vector< uint8_t > & ) > > _afterInstructionHandlers;
+            /*
+             * Handler lists are immutable once published.
+             * Registration copies the current list and atomically replaces
+             * it, while holding the lock, so hooks only have to atomically
+             * retain the current list, without locking or copying.
+             */
+            template< typename _T_ >
+            using HandlerList = std::shared_ptr< const std::vector< _T_ > >;
+            
+            HandlerList< std::function< void( void ) > >                   _onStart;
+            HandlerList< std::function< void( void ) > >                   _onStop;
+            HandlerList< std::function< bool( uint32_t ) > >               _interruptHandlers;
+            HandlerList< std::function< bool( const std::exception & ) > > _exceptionHandlers;
+            HandlerList< std::function< void( uint64_t, size_t ) > >       _invalidMemoryHandlers;
+            HandlerList< std::function< void( uint64_t, size_t ) > >       _validMemoryHandlers;
+            std::shared_ptr< const BeforeInstructionHandlers >             _beforeInstructionHandlers;
+            std::shared_ptr< const AfterInstructionHandlers >              _afterInstructionHandlers;
+            std::shared_ptr< const MemoryWriteHandlers >                   _memoryWriteHandlers;
+            std::shared_ptr< const BlockHandlers >                         _blockHandlers;
+            
+            template< typename _T_ >
+            static void _append( HandlerList< _T_ > & list, const typename std::vector< _T_ >::value_type & value )
+            {
+                auto handlers( std::make_shared< std::vector< _T_ > >( *( std::atomic_load( &list ) ) ) );
+                
+                handlers->push_back( value );
+                
+                std::atomic_store( &list, HandlerList< _T_ >( handlers ) );
+            }
+            
+            template< typename _T_ >
+            static void _remove( HandlerList< _T_ > & list, uint64_t id )
+            {
+                auto handlers( std::make_shared< std::vector< _T_ > >( *( std::atomic_load( &list ) ) ) );
+                
+                handlers->erase( std::remove_if( handlers->begin(), handlers->end(), [ & ]( const _T_ & p ) { return p.first == id; } ), handlers->end() );
+                
+                std::atomic_store( &list, HandlerList< _T_ >( handlers ) );
+            }
+            
+            std::map< uint64_t, std::unique_ptr< ExecuteHandler > > _executeHandlers;
             
             template< typename _T_ >
             _T_ _readRegister( int reg ) const
@@ -110,13 +225,11 @@ namespace UB
         return address;
     }
     
-    Engine::Engine( size_t memory ):
-        impl( std::make_unique< IMPL >( memory ) )
+    Engine::Engine( size_t memory, const std::string & memoryFile ):
+        impl( std::make_unique< IMPL >( *( this ), memory, memoryFile ) )
     {
         uc_hook h1;
         uc_hook h2;
-        uc_hook h3;
-        uc_hook h4;
         uc_err  e;
         
         if( ( e = uc_hook_add( this->impl->_uc, &h1, UC_HOOK_INTR, reinterpret_cast< void * >( &IMPL::_handleInterrupt ), this, 0, std::numeric_limits< uint64_t >::max() ) ) != UC_ERR_OK )
@@ -124,17 +237,18 @@ namespace UB
             throw std::runtime_error( uc_strerror( e ) );
         }
         
-        if( ( e = uc_hook_add( this->impl->_uc, &h2, UC_HOOK_CODE, reinterpret_cast< void * >( &IMPL::_handleInstruction ), this, 0, std::numeric_limits< uint64_t >::max() ) ) != UC_ERR_OK )
+        if( ( e = uc_hook_add( this->impl->_uc, &h2, UC_HOOK_MEM_INVALID, reinterpret_cast< void * >( &IMPL::_handleInvalidMemoryAccess ), this, 0, std::numeric_limits< uint64_t >::max() ) ) != UC_ERR_OK )
         {
             throw std::runtime_error( uc_strerror( e ) );
         }
         
-        if( ( e = uc_hook_add( this->impl->_uc, &h3, UC_HOOK_MEM_INVALID, reinterpret_cast< void * >( &IMPL::_handleInvalidMemoryAccess ), this, 0, std::numeric_limits< uint64_t >::max() ) ) != UC_ERR_OK )
-        {
-            throw std::runtime_error( uc_strerror( e ) );
-        }
-        
-        if( ( e = uc_hook_add( this->impl->_uc, &h4, UC_HOOK_MEM_WRITE + UC_HOOK_MEM_FETCH, reinterpret_cast< void * >( &IMPL::_handleValidMemoryAccess ), this, 0, std::numeric_limits< uint64_t >::max() ) ) != UC_ERR_OK )
+        /*
+         * The block hook is always installed, as it tracks translated code
+         * and catches stop requests made while the emulator wasn't running.
+         * It only runs once per block, so it doesn't prevent the emulator
+         * from running translated code at full speed.
+         */
+        if( ( e = uc_hook_add( this->impl->_uc, &( this->impl->_blockHook ), UC_HOOK_BLOCK, reinterpret_cast< void * >( &IMPL::_handleBlock ), this, 0, std::numeric_limits< uint64_t >::max() ) ) != UC_ERR_OK )
         {
             throw std::runtime_error( uc_strerror( e ) );
         }
@@ -506,13 +620,106 @@ namespace UB
     {
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
-        return this->impl->_registers;
+        /*
+         * The emulator's registers are only read directly when it isn't
+         * running. Otherwise, without the instruction hook, the next block
+         * publishes them.
+         */
+        if( this->impl->_running == false )
+        {
+            return Registers( *( this ) );
+        }
+        
+        if( this->impl->_instructionHookInstalled == false )
+        {
+            this->impl->_registersRequested = true;
+        }
+        
+        {
+            std::lock_guard< std::mutex > lr( this->impl->_registersMutex );
+            
+            return this->impl->_registers;
+        }
     }
     
-    bool Engine::running( void ) const
+    RegisterFile Engine::snapshot( void ) const
     {
+        RegisterFile                            file;
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
+        this->impl->_snapshot( file );
+        
+        return file;
+    }
+    
+    RegisterFile Engine::hookSnapshot( void ) const
+    {
+        RegisterFile file;
+        
+        this->impl->_snapshot( file );
+        
+        return file;
+    }
+    
+    void Engine::publishRegisters( void )
+    {
+        this->impl->_publishRegisters();
+    }
+    
+    void Engine::IMPL::_snapshot( RegisterFile & file ) const
+    {
+        uc_err e;
+        
+        int regs[] =
+        {
+            UC_X86_REG_EAX,
+            UC_X86_REG_EBX,
+            UC_X86_REG_ECX,
+            UC_X86_REG_EDX,
+            UC_X86_REG_ESI,
+            UC_X86_REG_EDI,
+            UC_X86_REG_ESP,
+            UC_X86_REG_EBP,
+            UC_X86_REG_EIP,
+            UC_X86_REG_EFLAGS,
+            UC_X86_REG_CS,
+            UC_X86_REG_DS,
+            UC_X86_REG_SS,
+            UC_X86_REG_ES,
+            UC_X86_REG_FS,
+            UC_X86_REG_GS
+        };
+        
+        void * values[] =
+        {
+            &( file.eax ),
+            &( file.ebx ),
+            &( file.ecx ),
+            &( file.edx ),
+            &( file.esi ),
+            &( file.edi ),
+            &( file.esp ),
+            &( file.ebp ),
+            &( file.eip ),
+            &( file.eflags ),
+            &( file.cs ),
+            &( file.ds ),
+            &( file.ss ),
+            &( file.es ),
+            &( file.fs ),
+            &( file.gs )
+        };
+        
+        static_assert( sizeof( regs ) / sizeof( regs[ 0 ] ) == sizeof( values ) / sizeof( values[ 0 ] ), "Register count mismatch" );
+        
+        if( ( e = uc_reg_read_batch( this->_uc, regs, values, static_cast< int >( sizeof( regs ) / sizeof( regs[ 0 ] ) ) ) ) != UC_ERR_OK )
+        {
+            throw std::runtime_error( uc_strerror( e ) );
+        }
+    }
+    
+    bool Engine::running( void ) const
+    {
         return this->impl->_running;
     }
     
@@ -520,56 +727,227 @@ namespace UB
     {
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
-        this->impl->_onStart.push_back( f );
+        IMPL::_append( this->impl->_onStart, f );
     }
     
     void Engine::onStop( const std::function< void( void ) > f )
     {
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
-        this->impl->_onStop.push_back( f );
+        IMPL::_append( this->impl->_onStop, f );
     }
     
     void Engine::onInterrupt( const std::function< bool( uint32_t ) > handler )
     {
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
-        this->impl->_interruptHandlers.push_back( handler );
+        IMPL::_append( this->impl->_interruptHandlers, handler );
     }
     
     void Engine::onException( const std::function< bool( const std::exception & ) > handler )
     {
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
-        this->impl->_exceptionHandlers.push_back( handler );
+        IMPL::_append( this->impl->_exceptionHandlers, handler );
     }
     
     void Engine::onInvalidMemoryAccess( const std::function< void( uint64_t, size_t ) > handler )
     {
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
-        this->impl->_invalidMemoryHandlers.push_back( handler );
+        IMPL::_append( this->impl->_invalidMemoryHandlers, handler );
     }
     
     void Engine::onValidMemoryAccess( const std::function< void( uint64_t, size_t ) > handler )
     {
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
-        this->impl->_validMemoryHandlers.push_back( handler );
+        IMPL::_append( this->impl->_validMemoryHandlers, handler );
+        
+        this->impl->_updateHooks();
+    }
+    
+    uint64_t Engine::beforeInstruction( const std::function< void( uint64_t, const std::vector< uint8_t > & ) > handler )
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        uint64_t                                id( this->impl->_nextHandlerID++ );
+        
+        IMPL::_append( this->impl->_beforeInstructionHandlers, { id, handler } );
+        
+        this->impl->_updateHooks();
+        
+        return id;
+    }
+    
+    uint64_t Engine::afterInstruction( const std::function< void( uint64_t, const Registers &, const std::vector< uint8_t > & ) > handler )
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        uint64_t                                id( this->impl->_nextHandlerID++ );
+        
+        IMPL::_append( this->impl->_afterInstructionHandlers, { id, handler } );
+        
+        this->impl->_updateHooks();
+        
+        return id;
+    }
+    
+    void Engine::removeInstructionHandler( uint64_t id )
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        
+        IMPL::_remove( this->impl->_beforeInstructionHandlers, id );
+        IMPL::_remove( this->impl->_afterInstructionHandlers,  id );
+        
+        this->impl->_updateHooks();
+    }
+    
+    uint64_t Engine::onMemoryWrite( const std::function< void( uint64_t, size_t, uint64_t ) > handler )
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        uint64_t                                id( this->impl->_nextHandlerID++ );
+        
+        IMPL::_append( this->impl->_memoryWriteHandlers, { id, handler } );
+        
+        this->impl->_updateHooks();
+        
+        return id;
+    }
+    
+    void Engine::removeMemoryWriteHandler( uint64_t id )
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        
+        IMPL::_remove( this->impl->_memoryWriteHandlers, id );
+        
+        this->impl->_updateHooks();
+    }
+    
+    uint64_t Engine::onBlock( const std::function< void( uint64_t, size_t ) > handler )
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        uint64_t                                id( this->impl->_nextHandlerID++ );
+        
+        IMPL::_append( this->impl->_blockHandlers, { id, handler } );
+        
+        this->impl->_updateHooks();
+        
+        return id;
+    }
+    
+    void Engine::removeBlockHandler( uint64_t id )
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        
+        IMPL::_remove( this->impl->_blockHandlers, id );
+        
+        this->impl->_updateHooks();
+    }
+    
+    uint64_t Engine::onExecute( uint64_t begin, uint64_t end, const std::function< void( uint64_t ) > handler )
+    {
+        return this->onExecute
+        (
+            begin,
+            end,
+            [ = ]( uint64_t address, size_t size )
+            {
+                ( void )size;
+                
+                handler( address );
+            }
+        );
+    }
+    
+    uint64_t Engine::onExecute( uint64_t begin, uint64_t end, const std::function< void( uint64_t, size_t ) > handler )
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        auto                                    execute( std::make_unique< IMPL::ExecuteHandler >() );
+        uint64_t                                id( this->impl->_nextHandlerID++ );
+        
+        if( end < begin )
+        {
+            throw std::runtime_error( "Invalid address range: " + String::toHex( begin ) + " - " + String::toHex( end ) );
+        }
+        
+        execute->impl      = this->impl.get();
+        execute->begin     = begin;
+        execute->end       = end;
+        execute->handler   = handler;
+        execute->hook      = 0;
+        execute->installed = false;
+        execute->removed   = false;
+        
+        this->impl->_executeHandlers[ id ]      = std::move( execute );
+        this->impl->_executeHandlersChanged = true;
+        
+        this->impl->_updateHooks();
+        
+        return id;
     }
     
-    void Engine::beforeInstruction( const std::function< void( uint64_t, const std::vector< uint8_t > & ) > handler )
+    void Engine::removeExecuteHandler( uint64_t id )
     {
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        auto                                    it( this->impl->_executeHandlers.find( id ) );
+        
+        if( it == this->impl->_executeHandlers.end() )
+        {
+            return;
+        }
+        
+        /*
+         * The hook itself can only be deleted while the emulator isn't
+         * executing code, but the handler won't be called anymore.
+         */
+        it->second->removed                 = true;
+        this->impl->_executeHandlersChanged = true;
         
-        this->impl->_beforeInstructionHandlers.push_back( handler );
+        this->impl->_updateHooks();
     }
     
-    void Engine::afterInstruction( const std::function< void( uint64_t, const Registers &, const std::vector< uint8_t > & ) > handler )
+    void Engine::protect( size_t address, size_t size )
     {
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        uc_err                                  e;
+        size_t                                  end( address + size );
+        size_t                                  pageBegin( ( address + 0xFFF ) & ~static_cast< size_t >( 0xFFF ) );
+        size_t                                  pageEnd( end & ~static_cast< size_t >( 0xFFF ) );
+        
+        if( this->impl->_running )
+        {
+            throw std::runtime_error( "Cannot protect memory while the engine is running" );
+        }
         
-        this->impl->_afterInstructionHandlers.push_back( handler );
+        if( size == 0 )
+        {
+            return;
+        }
+        
+        if( end > this->impl->_memory )
+        {
+            throw std::runtime_error( "Cannot protect address " + String::toHex( address ) + " - Not enough memory allocated" );
+        }
+        
+        /*
+         * Unicorn can only change permissions of whole pages, which makes
+         * protected accesses fault without any cost for other accesses.
+         * Bytes outside whole pages are not enforced, as a ranged memory
+         * hook would send every access through the slow path.
+         */
+        if( pageBegin >= pageEnd )
+        {
+            return;
+        }
+        
+        if( ( e = uc_mem_protect( this->impl->_uc, pageBegin, pageEnd - pageBegin, UC_PROT_READ ) ) != UC_ERR_OK )
+        {
+            throw std::runtime_error( uc_strerror( e ) );
+        }
+    }
+    
+    const uint8_t * Engine::view( size_t address, size_t size ) const
+    {
+        return this->impl->_view( address, size );
     }
     
     std::vector< uint8_t > Engine::read( size_t address, size_t size )
@@ -577,6 +955,11 @@ namespace UB
         return this->impl->_read( address, size );
     }
     
+    void Engine::read( size_t address, uint8_t * bytes, size_t size ) const
+    {
+        this->impl->_read( address, bytes, size );
+    }
+    
     void Engine::write( size_t address, const std::vector< uint8_t > & bytes )
     {
         this->impl->_write( address, &( bytes[ 0 ] ), bytes.size() );
@@ -597,11 +980,12 @@ namespace UB
                 return false;
             }
             
-            this->impl->_running = true;
+            this->impl->_running       = true;
+            this->impl->_stopRequested = false;
             
             this->impl->_cv.notify_all();
             
-            for( const auto & f: this->impl->_onStart )
+            for( const auto & f: *( std::atomic_load( &( this->impl->_onStart ) ) ) )
             {
                 f();
             }
@@ -613,25 +997,65 @@ namespace UB
             {
                 try
                 {
-                    uc_err e;
+                    uc_err   e;
+                    uint64_t begin( address );
                     
-                    if( ( e = uc_emu_start( this->impl->_uc, address, std::numeric_limits< uint64_t >::max(), 0, 0 ) ) != UC_ERR_OK )
+                    /*
+                     * Emulation is restarted from the current location when
+                     * the instruction hook needs to be installed or removed,
+                     * as hooks can't safely be changed while the emulator is
+                     * executing code.
+                     */
                     {
-                        throw std::runtime_error( uc_strerror( e ) );
+                        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+                        
+                        this->impl->_emulationThread = std::this_thread::get_id();
                     }
-                }
-                catch( const std::exception & e )
-                {
-                    std::vector< std::function< bool( const std::exception & ) > > handlers;
-                    bool                                                           handled( false );
                     
+                    while( true )
                     {
-                        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+                        {
+                            std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+                            
+                            this->impl->_restart = false;
+                            
+                            this->impl->_applyHooks();
+                        }
                         
-                        handlers = this->impl->_exceptionHandlers;
+                        /*
+                         * A restart or a stop requested before the emulator
+                         * starts would be lost, as starting the emulator
+                         * clears its stop request. The block hook checks
+                         * for them, before executing the first block.
+                         */
+                        if( ( e = uc_emu_start( this->impl->_uc, begin, std::numeric_limits< uint64_t >::max(), 0, 0 ) ) != UC_ERR_OK )
+                        {
+                            throw std::runtime_error( uc_strerror( e ) );
+                        }
+                        
+                        {
+                            std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+                            
+                            if( this->impl->_restart == false || this->impl->_stopRequested )
+                            {
+                                break;
+                            }
+                            
+                            /*
+                             * In 16 bits mode, the emulator computes IP by
+                             * subtracting CS * 16 from the start address, and
+                             * only writes the lower 16 bits of EIP.
+                             */
+                            begin = Engine::getAddress( this->cs(), this->ip() );
+                        }
                     }
+                }
+                catch( const std::exception & e )
+                {
+                    auto handlers( std::atomic_load( &( this->impl->_exceptionHandlers ) ) );
+                    bool handled( false );
                     
-                    for( const auto & f: handlers )
+                    for( const auto & f: *( handlers ) )
                     {
                         if( f( e ) )
                         {
@@ -652,7 +1076,7 @@ namespace UB
                     
                     this->impl->_cv.notify_all();
                     
-                    for( const auto & f: this->impl->_onStop )
+                    for( const auto & f: *( std::atomic_load( &( this->impl->_onStop ) ) ) )
                     {
                         f();
                     }
@@ -673,6 +1097,8 @@ namespace UB
             return;
         }
         
+        this->impl->_stopRequested = true;
+        
         uc_emu_stop( this->impl->_uc );
     }
     
@@ -690,39 +1116,143 @@ namespace UB
         );
     }
     
-    Engine::IMPL::IMPL( size_t memory ):
-        _memory( memory ),
-        _uc( nullptr ),
-        _running( false )
+    Engine::IMPL::IMPL( Engine & engine, size_t memory, const std::string & memoryFile ):
+        _engine(                    engine ),
+        _memory(                    memory ),
+        _ram(                       nullptr ),
+        _ramFile(                   -1 ),
+        _instructionAddress(        0 ),
+        _lastInstructionAddress(    0 ),
+        _uc(                        nullptr ),
+        _instructionHook(           0 ),
+        _validMemoryHook(           0 ),
+        _memoryWriteHook(           0 ),
+        _blockHook(                 0 ),
+        _instructionHookInstalled(  false ),
+        _validMemoryHookInstalled(  false ),
+        _memoryWriteHookInstalled(  false ),
+        _running(                   false ),
+        _restart(                   false ),
+        _stopRequested(             false ),
+        _registersRequested(        false ),
+        _translatedPages(           ( memory + PageSize - 1 ) / PageSize, false ),
+        _executeHandlersChanged(    false ),
+        _nextHandlerID(             1 ),
+        _onStart(                   std::make_shared< std::vector< std::function< void( void ) > > >() ),
+        _onStop(                    std::make_shared< std::vector< std::function< void( void ) > > >() ),
+        _interruptHandlers(         std::make_shared< std::vector< std::function< bool( uint32_t ) > > >() ),
+        _exceptionHandlers(         std::make_shared< std::vector< std::function< bool( const std::exception & ) > > >() ),
+        _invalidMemoryHandlers(     std::make_shared< std::vector< std::function< void( uint64_t, size_t ) > > >() ),
+        _validMemoryHandlers(       std::make_shared< std::vector< std::function< void( uint64_t, size_t ) > > >() ),
+        _beforeInstructionHandlers( std::make_shared< BeforeInstructionHandlers >() ),
+        _afterInstructionHandlers(  std::make_shared< AfterInstructionHandlers >() ),
+        _memoryWriteHandlers(       std::make_shared< MemoryWriteHandlers >() ),
+        _blockHandlers(             std::make_shared< BlockHandlers >() )
     {
         uc_err e;
         
-        if( ( e = uc_open( UC_ARCH_X86, UC_MODE_16, &( this->_uc ) ) ) != UC_ERR_OK )
-        {
-            throw std::runtime_error( uc_strerror( e ) );
-        }
+        this->_instruction.reserve( MaxInstructionSize );
+        this->_lastInstruction.reserve( MaxInstructionSize );
         
-        if( memory > 0 )
+        /*
+         * The destructor isn't called if construction fails, so anything
+         * acquired so far is released before rethrowing.
+         */
+        try
         {
-            if( ( e = uc_mem_map( this->_uc, 0, memory, UC_PROT_ALL ) ) != UC_ERR_OK )
+            if( ( e = uc_open( UC_ARCH_X86, UC_MODE_16, &( this->_uc ) ) ) != UC_ERR_OK )
             {
                 throw std::runtime_error( uc_strerror( e ) );
             }
+            
+            if( memory > 0 )
+            {
+                void * ram;
+                int    flags( MAP_PRIVATE | MAP_ANON );
+                
+                /*
+                 * Guest memory is owned by the engine, so it can be accessed
+                 * directly, without going through the emulator.
+                 * It's either anonymous memory, which is zeroed lazily by the
+                 * system, or a shared mapping of a file.
+                 */
+                if( memoryFile.length() > 0 )
+                {
+                    struct stat st;
+                    
+                    if( ( this->_ramFile = open( memoryFile.c_str(), O_RDWR | O_CREAT, 0644 ) ) == -1 )
+                    {
+                        throw std::runtime_error( "Cannot open memory file: " + memoryFile );
+                    }
+                    
+                    if( fstat( this->_ramFile, &st ) != 0 || ( static_cast< size_t >( st.st_size ) < memory && ftruncate( this->_ramFile, static_cast< off_t >( memory ) ) != 0 ) )
+                    {
+                        throw std::runtime_error( "Cannot resize memory file: " + memoryFile );
+                    }
+                    
+                    flags = MAP_SHARED;
+                }
+                
+                if( ( ram = mmap( nullptr, memory, PROT_READ | PROT_WRITE, flags, this->_ramFile, 0 ) ) == MAP_FAILED )
+                {
+                    throw std::runtime_error( "Cannot allocate " + std::to_string( memory ) + " bytes of memory" );
+                }
+                
+                this->_ram = static_cast< uint8_t * >( ram );
+                
+#ifdef MADV_HUGEPAGE
+                if( this->_ramFile == -1 )
+                {
+                    madvise( ram, memory, MADV_HUGEPAGE );
+                }
+#endif
+                
+                if( ( e = uc_mem_map_ptr( this->_uc, 0, memory, UC_PROT_ALL, this->_ram ) ) != UC_ERR_OK )
+                {
+                    throw std::runtime_error( uc_strerror( e ) );
+                }
+            }
+        }
+        catch( ... )
+        {
+            this->_close();
+            
+            throw;
         }
     }
     
     Engine::IMPL::~IMPL( void )
+    {
+        this->_close();
+    }
+    
+    void Engine::IMPL::_close( void )
     {
         if( this->_uc != nullptr )
         {
             uc_close( this->_uc );
+            
+            this->_uc = nullptr;
+        }
+        
+        if( this->_ram != nullptr )
+        {
+            munmap( this->_ram, this->_memory );
+            
+            this->_ram = nullptr;
+        }
+        
+        if( this->_ramFile != -1 )
+        {
+            close( this->_ramFile );
+            
+            this->_ramFile = -1;
         }
     }
     
     void Engine::IMPL::_handleInterrupt( uc_engine * uc, uint32_t i, void * data )
     {
-        Engine                                         * engine;
-        std::vector< std::function< bool( uint32_t ) > > handlers;
+        Engine * engine;
         
         ( void )uc;
         
@@ -733,13 +1263,7 @@ namespace UB
             throw std::runtime_error( "Fatal internal error: unknown engine" );
         }
         
-        {
-            std::lock_guard< std::recursive_mutex > l( engine->impl->_rmtx );
-            
-            handlers = engine->impl->_interruptHandlers;
-        }
-        
-        for( const auto & f: handlers )
+        for( const auto & f: *( std::atomic_load( &( engine->impl->_interruptHandlers ) ) ) )
         {
             if( f( i ) )
             {
@@ -752,14 +1276,11 @@ namespace UB
     
     void Engine::IMPL::_handleInstruction( uc_engine * uc, uint64_t address, uint32_t size, void * data )
     {
-        Engine               * engine;
-        std::vector< uint8_t > last;
-        uint64_t               lastAddress;
-        Registers              lastRegisters;
-        std::vector< uint8_t > current;
-        
-        std::vector< std::function< void( uint64_t, const std::vector< uint8_t > & ) > > before;
-        std::vector< std::function< void( uint64_t, const Registers &, const std::vector< uint8_t > & ) > > after;
+        Engine                                           * engine;
+        std::shared_ptr< const BeforeInstructionHandlers > before;
+        std::shared_ptr< const AfterInstructionHandlers >  after;
+        RegisterFile                                       file;
+        bool                                               skip( false );
         
         ( void )uc;
         
@@ -770,44 +1291,121 @@ namespace UB
             throw std::runtime_error( "Fatal internal error: unknown engine" );
         }
         
+        if( size == 0 || size > MaxInstructionSize )
         {
-            std::lock_guard< std::recursive_mutex > l( engine->impl->_rmtx );
+            throw std::runtime_error( "Fatal internal error: cannot read current instruction" );
+        }
+        
+        /*
+         * When the emulation was restarted from a hook, the instruction
+         * at the restart address is executed again, but its handlers
+         * have already been called.
+         */
+        if( engine->impl->_skipInstruction.has_value() )
+        {
+            skip = engine->impl->_skipInstruction.value() == address;
             
-            before        = engine->impl->_beforeInstructionHandlers;
-            after         = engine->impl->_afterInstructionHandlers;
-            last          = engine->impl->_lastInstruction;
-            lastAddress   = engine->impl->_lastInstructionAddress;
-            lastRegisters = engine->impl->_registers;
-            current       = engine->read( address, size );
+            engine->impl->_skipInstruction.reset();
             
-            if( current.size() == 0 )
+            if( skip && engine->impl->_instruction.size() > 0 )
             {
-                throw std::runtime_error( "Fatal internal error: cannot read current instruction" );
+                return;
             }
+        }
+        
+        before = std::atomic_load( &( engine->impl->_beforeInstructionHandlers ) );
+        after  = std::atomic_load( &( engine->impl->_afterInstructionHandlers ) );
+        
+        /*
+         * Only the emulation thread modifies the instruction buffers and the
+         * last registers, so no lock is needed, except for publishing the
+         * current registers.
+         * The current instruction becomes the last one by swapping
+         * buffers, so the reserved storage is reused on every call.
+         */
+        {
+            using std::swap;
             
-            engine->impl->_lastInstruction        = current;
-            engine->impl->_lastInstructionAddress = address;
-            engine->impl->_registers              = *( engine );
+            swap( engine->impl->_lastInstruction, engine->impl->_instruction );
         }
         
-        if( last.size() > 0 )
+        engine->impl->_lastInstructionAddress = engine->impl->_instructionAddress;
+        engine->impl->_instructionAddress     = address;
+        
+        engine->impl->_instruction.resize( size );
+        engine->impl->_snapshot( file );
+        engine->impl->_read( address, engine->impl->_instruction.data(), size );
+        
         {
-            for( const auto & f: after )
+            std::lock_guard< std::mutex > l( engine->impl->_registersMutex );
+            
+            engine->impl->_lastRegisters = engine->impl->_registers;
+            engine->impl->_registers     = Registers( file );
+        }
+        
+        if( skip )
+        {
+            return;
+        }
+        
+        engine->impl->_hookAddress = address;
+        
+        if( engine->impl->_lastInstruction.size() > 0 )
+        {
+            for( const auto & p: *( after ) )
             {
-                f( lastAddress, lastRegisters, last );
+                p.second( engine->impl->_lastInstructionAddress, engine->impl->_lastRegisters, engine->impl->_lastInstruction );
             }
         }
         
-        for( const auto & f: before )
+        for( const auto & p: *( before ) )
+        {
+            p.second( address, engine->impl->_instruction );
+        }
+        
+        engine->impl->_hookAddress.reset();
+    }
+    
+    void Engine::IMPL::_handleExecute( uc_engine * uc, uint64_t address, uint32_t size, void * data )
+    {
+        ExecuteHandler * execute;
+        
+        ( void )uc;
+        
+        execute = static_cast< ExecuteHandler * >( data );
+        
+        if( execute == nullptr )
+        {
+            throw std::runtime_error( "Fatal internal error: unknown execute handler" );
+        }
+        
+        if( execute->removed )
         {
-            f( address, current );
+            return;
         }
+        
+        if( execute->skip.has_value() )
+        {
+            bool skip( execute->skip.value() == address );
+            
+            execute->skip.reset();
+            
+            if( skip )
+            {
+                return;
+            }
+        }
+        
+        execute->impl->_hookAddress = address;
+        
+        execute->handler( address, size );
+        
+        execute->impl->_hookAddress.reset();
     }
     
     bool Engine::IMPL::_handleInvalidMemoryAccess( uc_engine * uc, uc_mem_type type, uint64_t address, int size, int64_t value, void * data )
     {
-        Engine                                                 * engine;
-        std::vector< std::function< void( uint64_t, size_t ) > > handlers;
+        Engine * engine;
         
         ( void )uc;
         ( void )type;
@@ -820,13 +1418,7 @@ namespace UB
             throw std::runtime_error( "Fatal internal error: unknown engine" );
         }
         
-        {
-            std::lock_guard< std::recursive_mutex > l( engine->impl->_rmtx );
-            
-            handlers = engine->impl->_invalidMemoryHandlers;
-        }
-        
-        for( const auto & f: handlers )
+        for( const auto & f: *( std::atomic_load( &( engine->impl->_invalidMemoryHandlers ) ) ) )
         {
             f( address, numeric_cast< size_t >( size ) );
         }
@@ -834,14 +1426,12 @@ namespace UB
         return false;
     }
     
-    void Engine::IMPL::_handleValidMemoryAccess( uc_engine * uc, uc_mem_type type, uint64_t address, int size, int64_t value, void * data )
+    void Engine::IMPL::_handleMemoryWrite( uc_engine * uc, uc_mem_type type, uint64_t address, int size, int64_t value, void * data )
     {
-        Engine                                                 * engine;
-        std::vector< std::function< void( uint64_t, size_t ) > > handlers;
+        Engine * engine;
         
         ( void )uc;
         ( void )type;
-        ( void )value;
         
         engine = static_cast< Engine * >( data );
         
@@ -850,45 +1440,105 @@ namespace UB
             throw std::runtime_error( "Fatal internal error: unknown engine" );
         }
         
+        for( const auto & p: *( std::atomic_load( &( engine->impl->_memoryWriteHandlers ) ) ) )
         {
-            std::lock_guard< std::recursive_mutex > l( engine->impl->_rmtx );
+            p.second( address, numeric_cast< size_t >( size ), static_cast< uint64_t >( value ) );
+        }
+    }
+    
+    void Engine::IMPL::_handleBlock( uc_engine * uc, uint64_t address, uint32_t size, void * data )
+    {
+        Engine * engine;
+        
+        engine = static_cast< Engine * >( data );
+        
+        if( engine == nullptr )
+        {
+            throw std::runtime_error( "Fatal internal error: unknown engine" );
+        }
+        
+        engine->impl->_markTranslated( address, size );
+        
+        /*
+         * The block hook is called before the block's code, which isn't
+         * executed once the emulator was asked to stop, so the emulation
+         * resumes at the start of the block.
+         */
+        if( engine->impl->_restart || engine->impl->_stopRequested )
+        {
+            uc_emu_stop( uc );
             
-            handlers = engine->impl->_validMemoryHandlers;
+            return;
         }
         
-        for( const auto & f: handlers )
+        if( engine->impl->_registersRequested.exchange( false ) )
         {
-            f( address, numeric_cast< size_t >( size ) );
+            engine->impl->_publishRegisters();
+        }
+        
+        for( const auto & p: *( std::atomic_load( &( engine->impl->_blockHandlers ) ) ) )
+        {
+            p.second( address, size );
         }
     }
     
-    std::vector< uint8_t > Engine::IMPL::_read( size_t address, size_t size )
+    void Engine::IMPL::_handleValidMemoryAccess( uc_engine * uc, uc_mem_type type, uint64_t address, int size, int64_t value, void * data )
     {
-        uc_err                                  e;
-        std::lock_guard< std::recursive_mutex > l( this->_rmtx );
+        Engine * engine;
         
-        if( size == 0 )
+        ( void )uc;
+        ( void )type;
+        ( void )value;
+        
+        engine = static_cast< Engine * >( data );
+        
+        if( engine == nullptr )
         {
-            return {};
+            throw std::runtime_error( "Fatal internal error: unknown engine" );
         }
         
-        if( address + size >= this->_memory )
+        for( const auto & f: *( std::atomic_load( &( engine->impl->_validMemoryHandlers ) ) ) )
+        {
+            f( address, numeric_cast< size_t >( size ) );
+        }
+    }
+    
+    const uint8_t * Engine::IMPL::_view( size_t address, size_t size ) const
+    {
+        if( address > this->_memory || size > this->_memory - address )
         {
             throw std::runtime_error( "Cannot read from address " + String::toHex( address ) + " - Not enough memory allocated" );
         }
         
+        return this->_ram + address;
+    }
+    
+    std::vector< uint8_t > Engine::IMPL::_read( size_t address, size_t size ) const
+    {
+        if( size == 0 )
+        {
+            return {};
+        }
+        
         {
             std::vector< uint8_t > bytes( size, 0 );
             
-            if( ( e = uc_mem_read( this->_uc, address, &( bytes[ 0 ] ), size ) ) != UC_ERR_OK )
-            {
-                throw std::runtime_error( uc_strerror( e ) );
-            }
+            this->_read( address, &( bytes[ 0 ] ), size );
             
             return bytes;
         }
     }
     
+    void Engine::IMPL::_read( size_t address, uint8_t * bytes, size_t size ) const
+    {
+        if( size == 0 )
+        {
+            return;
+        }
+        
+        std::memcpy( bytes, this->_view( address, size ), size );
+    }
+    
     void Engine::IMPL::_write( size_t address, const uint8_t * bytes, size_t size )
     {
         uc_err                                  e;
@@ -909,4 +1559,279 @@ namespace UB
             throw std::runtime_error( uc_strerror( e ) );
         }
     }
+    
+    bool Engine::IMPL::_needsInstructionHook( void ) const
+    {
+        return std::atomic_load( &( this->_beforeInstructionHandlers ) )->size() > 0 || std::atomic_load( &( this->_afterInstructionHandlers ) )->size() > 0;
+    }
+    
+    bool Engine::IMPL::_hooksChanged( void ) const
+    {
+        if( this->_needsInstructionHook() != this->_instructionHookInstalled )
+        {
+            return true;
+        }
+        
+        if( ( std::atomic_load( &( this->_validMemoryHandlers ) )->size() > 0 ) != this->_validMemoryHookInstalled )
+        {
+            return true;
+        }
+        
+        if( ( std::atomic_load( &( this->_memoryWriteHandlers ) )->size() > 0 ) != this->_memoryWriteHookInstalled )
+        {
+            return true;
+        }
+        
+        return this->_executeHandlersChanged;
+    }
+    
+    void Engine::IMPL::_updateHooks( void )
+    {
+        if( this->_hooksChanged() == false )
+        {
+            return;
+        }
+        
+        if( this->_running )
+        {
+            /*
+             * The emulation thread will apply the changes before restarting
+             * the emulation.
+             * If the changes are requested from a hook, the emulation stops
+             * before executing the current instruction, so hooks for that
+             * instruction must not be called twice.
+             */
+            if( std::this_thread::get_id() == this->_emulationThread && this->_hookAddress.has_value() )
+            {
+                this->_resumeAddress = this->_hookAddress;
+            }
+            
+            this->_restart = true;
+            
+            uc_emu_stop( this->_uc );
+        }
+        else
+        {
+            this->_applyHooks();
+        }
+    }
+    
+    void Engine::IMPL::_applyHooks( void )
+    {
+        uc_err e;
+        bool   needed( this->_needsInstructionHook() );
+        
+        if( this->_resumeAddress.has_value() )
+        {
+            uint64_t address( this->_resumeAddress.value() );
+            
+            this->_skipInstruction = address;
+            
+            for( const auto & p: this->_executeHandlers )
+            {
+                if( p.second->installed && address >= p.second->begin && address <= p.second->end )
+                {
+                    p.second->skip = address;
+                }
+            }
+            
+            this->_resumeAddress.reset();
+        }
+        
+        if( needed != this->_instructionHookInstalled )
+        {
+            if( needed )
+            {
+                if( ( e = uc_hook_add( this->_uc, &( this->_instructionHook ), UC_HOOK_CODE, reinterpret_cast< void * >( &IMPL::_handleInstruction ), &( this->_engine ), 0, std::numeric_limits< uint64_t >::max() ) ) != UC_ERR_OK )
+                {
+                    throw std::runtime_error( uc_strerror( e ) );
+                }
+                
+                /*
+                 * The last instruction was recorded before the hook was
+                 * removed, so it must not be reported to after-instruction
+                 * handlers.
+                 */
+                this->_instruction.clear();
+                this->_lastInstruction.clear();
+            }
+            else if( ( e = uc_hook_del( this->_uc, this->_instructionHook ) ) != UC_ERR_OK )
+            {
+                throw std::runtime_error( uc_strerror( e ) );
+            }
+            
+            this->_instructionHookInstalled = needed;
+            
+            this->_invalidateTranslations( 0, this->_memory );
+        }
+        
+        /*
+         * A global memory hook slows down every memory access, so it's only
+         * installed if needed.
+         */
+        if( std::atomic_load( &( this->_validMemoryHandlers ) )->size() > 0 && this->_validMemoryHookInstalled == false )
+        {
+            if( ( e = uc_hook_add( this->_uc, &( this->_validMemoryHook ), UC_HOOK_MEM_WRITE + UC_HOOK_MEM_FETCH, reinterpret_cast< void * >( &IMPL::_handleValidMemoryAccess ), &( this->_engine ), 0, std::numeric_limits< uint64_t >::max() ) ) != UC_ERR_OK )
+            {
+                throw std::runtime_error( uc_strerror( e ) );
+            }
+            
+            this->_validMemoryHookInstalled = true;
+        }
+        
+        {
+            bool write( std::atomic_load( &( this->_memoryWriteHandlers ) )->size() > 0 );
+            
+            if( write && this->_memoryWriteHookInstalled == false )
+            {
+                if( ( e = uc_hook_add( this->_uc, &( this->_memoryWriteHook ), UC_HOOK_MEM_WRITE, reinterpret_cast< void * >( &IMPL::_handleMemoryWrite ), &( this->_engine ), 0, std::numeric_limits< uint64_t >::max() ) ) != UC_ERR_OK )
+                {
+                    throw std::runtime_error( uc_strerror( e ) );
+                }
+                
+                this->_memoryWriteHookInstalled = true;
+            }
+            else if( write == false && this->_memoryWriteHookInstalled )
+            {
+                if( ( e = uc_hook_del( this->_uc, this->_memoryWriteHook ) ) != UC_ERR_OK )
+                {
+                    throw std::runtime_error( uc_strerror( e ) );
+                }
+                
+                this->_memoryWriteHookInstalled = false;
+            }
+        }
+        
+        if( this->_executeHandlersChanged )
+        {
+            for( auto it = this->_executeHandlers.begin(); it != this->_executeHandlers.end(); )
+            {
+                ExecuteHandler & execute( *( it->second ) );
+                
+                if( execute.removed == false && execute.installed )
+                {
+                    ++it;
+                    
+                    continue;
+                }
+                
+                if( execute.removed == false )
+                {
+                    if( ( e = uc_hook_add( this->_uc, &( execute.hook ), UC_HOOK_CODE, reinterpret_cast< void * >( &IMPL::_handleExecute ), &execute, execute.begin, execute.end ) ) != UC_ERR_OK )
+                    {
+                        throw std::runtime_error( uc_strerror( e ) );
+                    }
+                    
+                    execute.installed = true;
+                }
+                else if( execute.installed && ( e = uc_hook_del( this->_uc, execute.hook ) ) != UC_ERR_OK )
+                {
+                    throw std::runtime_error( uc_strerror( e ) );
+                }
+                
+                if( execute.begin < this->_memory )
+                {
+                    this->_invalidateTranslations( execute.begin, std::min< uint64_t >( execute.end, this->_memory - 1 ) - execute.begin + 1 );
+                }
+                
+                if( execute.removed )
+                {
+                    it = this->_executeHandlers.erase( it );
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            
+            this->_executeHandlersChanged = false;
+        }
+    }
+    
+    /*
+     * Called by the emulation thread for every executed block, so pages
+     * containing translated code are known without any emulator support.
+     */
+    void Engine::IMPL::_markTranslated( uint64_t address, size_t size )
+    {
+        uint64_t end( address + std::max< size_t >( size, 1 ) - 1 );
+        
+        if( address >= this->_memory )
+        {
+            return;
+        }
+        
+        end = std::min< uint64_t >( end, this->_memory - 1 );
+        
+        for( uint64_t page = address / PageSize; page <= end / PageSize; page++ )
+        {
+            this->_translatedPages[ page ] = true;
+        }
+    }
+    
+    /*
+     * With the instruction hook, registers are already published before
+     * every instruction, and the last registers must stay those of the
+     * previous instruction.
+     */
+    void Engine::IMPL::_publishRegisters( void )
+    {
+        RegisterFile file;
+        
+        if( this->_instructionHookInstalled )
+        {
+            return;
+        }
+        
+        this->_snapshot( file );
+        
+        {
+            std::lock_guard< std::mutex > l( this->_registersMutex );
+            
+            this->_registers = Registers( file );
+        }
+    }
+    
+    void Engine::IMPL::_invalidateTranslations( size_t address, size_t size )
+    {
+        /*
+         * Code hooks are checked when code is translated, so already
+         * translated blocks won't notice an installed or removed hook.
+         * Writing to guest memory discards the translated blocks for the
+         * written range, so pages containing translated code are simply
+         * rewritten with their own content. Other pages have nothing to
+         * discard.
+         */
+        std::vector< uint8_t > buffer( PageSize );
+        size_t                 end( std::min( address + size, this->_memory ) );
+        
+        if( size == 0 )
+        {
+            return;
+        }
+        
+        for( size_t page = address / PageSize; page * PageSize < end; page++ )
+        {
+            uc_err e;
+            size_t begin( page * PageSize );
+            size_t length( std::min( PageSize, this->_memory - begin ) );
+            
+            if( this->_translatedPages[ page ] == false )
+            {
+                continue;
+            }
+            
+            if( ( e = uc_mem_read( this->_uc, begin, &( buffer[ 0 ] ), length ) ) != UC_ERR_OK )
+            {
+                throw std::runtime_error( uc_strerror( e ) );
+            }
+            
+            if( ( e = uc_mem_write( this->_uc, begin, &( buffer[ 0 ] ), length ) ) != UC_ERR_OK )
+            {
+                throw std::runtime_error( uc_strerror( e ) );
+            }
+            
+            this->_translatedPages[ page ] = false;
+        }
+    }
 }
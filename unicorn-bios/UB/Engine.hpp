@@ -30,7 +30,9 @@
 #include <cstdint>
 #include <vector>
 #include <functional>
+#include <string>
 #include "UB/Registers.hpp"
+#include "UB/RegisterFile.hpp"
 
 namespace UB
 {
@@ -40,7 +42,7 @@ namespace UB
             
             static uint64_t getAddress( uint16_t segment, uint16_t offset );
             
-            Engine( size_t memory );
+            Engine( size_t memory, const std::string & memoryFile = "" );
             ~Engine( void );
             
             Engine( const Engine & o )              = delete;
@@ -126,7 +128,28 @@ namespace UB
             void eip( uint32_t value );
             void eflags( uint32_t value );
             
-            Registers registers( void ) const;
+            /*
+             * While the emulation is running, returns the registers published
+             * by the emulation thread, so they're consistent and can be read
+             * from any thread. Without an instruction hook, they're published
+             * at the start of the next block, when requested by this call,
+             * so they may be one block late.
+             */
+            Registers    registers( void ) const;
+            RegisterFile snapshot( void )  const;
+            
+            /*
+             * Publishes the current registers, for hooks pausing the
+             * emulation. Only valid from a hook, on the emulation thread.
+             */
+            void publishRegisters( void );
+            
+            /*
+             * Reads the registers without taking the engine's lock, so hooks
+             * never wait for other threads.
+             * Only valid from a hook, on the emulation thread.
+             */
+            RegisterFile hookSnapshot( void ) const;
             
             bool running( void ) const;
             
@@ -136,10 +159,68 @@ namespace UB
             void onException(           const std::function< bool( const std::exception & ) > handler );
             void onInvalidMemoryAccess( const std::function< void( uint64_t, size_t ) > handler );
             void onValidMemoryAccess(   const std::function< void( uint64_t, size_t ) > handler );
-            void beforeInstruction(     const std::function< void( uint64_t, const std::vector< uint8_t > & ) > handler );
-            void afterInstruction(      const std::function< void( uint64_t, const Registers &, const std::vector< uint8_t > & ) > handler );
+            
+            /*
+             * Instruction handlers require a per-instruction hook, which
+             * disables most of the emulator's optimizations.
+             * The hook is only installed while at least one instruction
+             * handler is registered, so handlers should be removed, using
+             * the returned identifier, as soon as they are not needed.
+             */
+            uint64_t beforeInstruction(       const std::function< void( uint64_t, const std::vector< uint8_t > & ) > handler );
+            uint64_t afterInstruction(        const std::function< void( uint64_t, const Registers &, const std::vector< uint8_t > & ) > handler );
+            void     removeInstructionHandler( uint64_t id );
+            
+            /*
+             * Memory write handlers receive the address, size and value of
+             * every write performed by the emulated code.
+             * The write hook is only installed while at least one handler is
+             * registered.
+             */
+            uint64_t onMemoryWrite(            const std::function< void( uint64_t, size_t, uint64_t ) > handler );
+            void     removeMemoryWriteHandler( uint64_t id );
+            
+            /*
+             * Block handlers receive the address and size of every basic
+             * block, when it starts executing.
+             * The block hook only runs once per block, so it's much cheaper
+             * than instruction or execute handlers. Adding or removing block
+             * handlers never restarts the emulation.
+             */
+            uint64_t onBlock(            const std::function< void( uint64_t, size_t ) > handler );
+            void     removeBlockHandler( uint64_t id );
+            
+            /*
+             * Execute handlers are only called for instructions located
+             * between begin and end (inclusive), and have no cost for other
+             * instructions.
+             * Unlike instruction handlers, they don't read the registers or
+             * the instruction's bytes, so they remain cheap enough to cover
+             * the whole address space. The second variant also receives the
+             * instruction's size.
+             */
+            uint64_t onExecute(            uint64_t begin, uint64_t end, const std::function< void( uint64_t ) > handler );
+            uint64_t onExecute(            uint64_t begin, uint64_t end, const std::function< void( uint64_t, size_t ) > handler );
+            void     removeExecuteHandler( uint64_t id );
+            
+            /*
+             * Makes a memory range read-only for the emulated code.
+             * Writes and instruction fetches are reported to invalid memory
+             * access handlers.
+             * Only whole 4KB pages inside the range are protected.
+             */
+            void protect( size_t address, size_t size );
+            
+            /*
+             * Direct pointer to guest memory, valid for the lifetime of the
+             * engine.
+             * Memory isn't copied, so its content may change while the
+             * emulation is running.
+             */
+            const uint8_t * view( size_t address, size_t size ) const;
             
             std::vector< uint8_t > read( size_t address, size_t size );
+            void                   read( size_t address, uint8_t * bytes, size_t size ) const;
             void                   write( size_t address, const std::vector< uint8_t > & bytes );
             void                   write( size_t address, const uint8_t * bytes, size_t size );
             
@@ -24,9 +24,15 @@
 
 #include "UB/FAT/Image.hpp"
 #include "UB/FAT/Functions.hpp"
-#include "UB/BinaryFileStream.hpp"
 #include "UB/BinaryDataStream.hpp"
+#include "UB/MappedFile.hpp"
+#include "UB/CachedFile.hpp"
+#include "UB/SparseFile.hpp"
 #include "UB/Casts.hpp"
+#include <unordered_map>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace UB
 {
@@ -36,16 +42,33 @@ namespace UB
         {
             public:
                 
-                IMPL( const std::string & path );
+                IMPL( const std::string & path, size_t cacheSize );
                 IMPL( const IMPL & o );
                 
-                std::string      _path;
-                BinaryDataStream _stream;
-                MBR              _mbr;
+                static constexpr uint64_t OverlayBlockSize       = 512;
+                static constexpr size_t   DefaultSparseCacheSize = 16 * 1024 * 1024;
+                
+                void _check( uint64_t offset, uint64_t size ) const;
+                void _read( uint64_t offset, uint64_t position, uint64_t size, const std::function< void( uint64_t, const uint8_t *, size_t ) > & handler ) const;
+                
+                std::vector< uint8_t > _read( uint64_t offset, uint64_t size ) const;
+                
+                std::string                          _path;
+                std::shared_ptr< const FileStorage > _file;
+                MBR                                  _mbr;
+                
+                /*
+                 * Copy-on-write overlay - The bitmap tells which blocks have
+                 * been written, so blocks which have not can be read from the
+                 * file without any lookup.
+                 */
+                std::vector< bool >                                    _written;
+                std::unordered_map< uint64_t, std::vector< uint8_t > > _blocks;
+                bool                                                   _modified;
         };
         
-        Image::Image( const std::string & path ):
-            impl( std::make_unique< IMPL >( path ) )
+        Image::Image( const std::string & path, size_t cacheSize ):
+            impl( std::make_unique< IMPL >( path, cacheSize ) )
         {}
         
         Image::Image( const Image & o ):
@@ -76,18 +99,156 @@ namespace UB
             return this->impl->_mbr;
         }
         
-        std::vector< uint8_t > Image::read( uint8_t cylinder, uint8_t head, uint8_t sector, uint8_t sectors )
+        uint64_t Image::size( void ) const
+        {
+            return this->impl->_file->size();
+        }
+        
+        std::vector< uint8_t > Image::read( uint8_t cylinder, uint8_t head, uint8_t sector, uint8_t sectors ) const
         {
             uint64_t lba( chsToLBA( this->impl->_mbr, cylinder, sector, head ) );
             
             return this->read( lba * this->impl->_mbr.bytesPerSector(), sectors * this->impl->_mbr.bytesPerSector() );
         }
         
-        std::vector< uint8_t > Image::read( uint64_t offset, uint64_t size )
+        std::vector< uint8_t > Image::read( uint64_t offset, uint64_t size ) const
+        {
+            std::vector< uint8_t > data( numeric_cast< size_t >( size ) );
+            
+            this->read
+            (
+                offset,
+                size,
+                [ & ]( uint64_t position, const uint8_t * bytes, size_t length )
+                {
+                    memcpy( data.data() + position, bytes, length );
+                }
+            );
+            
+            return data;
+        }
+        
+        void Image::read( uint64_t offset, uint64_t size, const std::function< void( uint64_t, const uint8_t *, size_t ) > & handler ) const
+        {
+            uint64_t position( 0 );
+            uint64_t clean( 0 );
+            
+            this->impl->_check( offset, size );
+            
+            if( this->impl->_blocks.size() == 0 )
+            {
+                this->impl->_file->read( offset, numeric_cast< size_t >( size ), handler );
+                
+                return;
+            }
+            
+            /*
+             * Consecutive blocks which have not been written are passed as a
+             * single chunk.
+             */
+            while( position < size )
+            {
+                uint64_t block( ( offset + position ) / IMPL::OverlayBlockSize );
+                uint64_t start( ( offset + position ) % IMPL::OverlayBlockSize );
+                uint64_t length( std::min( IMPL::OverlayBlockSize - start, size - position ) );
+                
+                if( this->impl->_written[ block ] )
+                {
+                    if( position > clean )
+                    {
+                        this->impl->_read( offset, clean, position - clean, handler );
+                    }
+                    
+                    handler( position, this->impl->_blocks.at( block ).data() + start, numeric_cast< size_t >( length ) );
+                    
+                    clean = position + length;
+                }
+                
+                position += length;
+            }
+            
+            if( size > clean )
+            {
+                this->impl->_read( offset, clean, size - clean, handler );
+            }
+        }
+        
+        void Image::write( uint64_t offset, const uint8_t * data, uint64_t size )
+        {
+            uint64_t position( 0 );
+            
+            this->impl->_check( offset, size );
+            
+            while( position < size )
+            {
+                uint64_t block( ( offset + position ) / IMPL::OverlayBlockSize );
+                uint64_t start( ( offset + position ) % IMPL::OverlayBlockSize );
+                uint64_t length( std::min( IMPL::OverlayBlockSize - start, size - position ) );
+                
+                if( this->impl->_written[ block ] == false )
+                {
+                    uint64_t base( block * IMPL::OverlayBlockSize );
+                    uint64_t available( std::min( IMPL::OverlayBlockSize, this->impl->_file->size() - base ) );
+                    
+                    this->impl->_blocks[ block ]  = this->impl->_read( base, available );
+                    this->impl->_written[ block ] = true;
+                }
+                
+                memcpy( this->impl->_blocks[ block ].data() + start, data + position, numeric_cast< size_t >( length ) );
+                
+                position += length;
+            }
+            
+            if( size > 0 )
+            {
+                this->impl->_modified = true;
+            }
+        }
+        
+        bool Image::modified( void ) const
+        {
+            return this->impl->_modified;
+        }
+        
+        void Image::commit( void )
         {
-            this->impl->_stream.Seek( numeric_cast< ssize_t >( offset ), BinaryStream::SeekDirection::Begin );
+            int fd;
             
-            return this->impl->_stream.Read( size );
+            if( this->impl->_modified == false )
+            {
+                return;
+            }
+            
+            if( SparseFile::isSparseFile( this->impl->_path ) )
+            {
+                throw std::runtime_error( "Cannot write to sparse image: " + this->impl->_path );
+            }
+            
+            if( ( fd = open( this->impl->_path.c_str(), O_WRONLY ) ) == -1 )
+            {
+                throw std::runtime_error( "Cannot open image for writing: " + this->impl->_path );
+            }
+            
+            for( const auto & p: this->impl->_blocks )
+            {
+                const std::vector< uint8_t > & bytes( p.second );
+                off_t                          offset( numeric_cast< off_t >( p.first * IMPL::OverlayBlockSize ) );
+                
+                if( pwrite( fd, bytes.data(), bytes.size(), offset ) != numeric_cast< ssize_t >( bytes.size() ) )
+                {
+                    close( fd );
+                    
+                    throw std::runtime_error( "Cannot write image: " + this->impl->_path );
+                }
+            }
+            
+            close( fd );
+            
+            /*
+             * Written blocks are kept, as the private mapping may not reflect
+             * the file's new content.
+             */
+            this->impl->_modified = false;
         }
         
         void swap( Image & o1, Image & o2 )
@@ -97,22 +258,90 @@ namespace UB
             swap( o1.impl, o2.impl );
         }
         
-        Image::IMPL::IMPL( const std::string & path ):
-            _path( path )
+        Image::IMPL::IMPL( const std::string & path, size_t cacheSize ):
+            _path(     path ),
+            _modified( false )
         {
-            BinaryFileStream stream( path );
-            
-            this->_stream = stream.ReadAll();
+            if( SparseFile::isSparseFile( path ) )
+            {
+                this->_file = std::make_shared< const SparseFile >( path, ( cacheSize > 0 ) ? cacheSize : DefaultSparseCacheSize );
+            }
+            else if( cacheSize > 0 )
+            {
+                this->_file = std::make_shared< const CachedFile >( path, cacheSize );
+            }
+            else
+            {
+                this->_file = std::make_shared< const MappedFile >( path );
+            }
             
-            stream.Seek( 0, BinaryStream::SeekDirection::Begin );
+            {
+                BinaryDataStream stream( this->_read( 0, std::min< uint64_t >( 512, this->_file->size() ) ) );
+                
+                this->_mbr = MBR( stream );
+            }
             
-            this->_mbr = MBR( stream );
+            this->_written.resize( numeric_cast< size_t >( ( this->_file->size() + OverlayBlockSize - 1 ) / OverlayBlockSize ) );
         }
         
+        /*
+         * Copies share the same mapping, so the image's data is never
+         * duplicated - Only the overlay's blocks are.
+         */
         Image::IMPL::IMPL( const IMPL & o ):
-            _path(   o._path ),
-            _stream( o._stream ),
-            _mbr(    o._mbr )
+            _path(     o._path ),
+            _file(     o._file ),
+            _mbr(      o._mbr ),
+            _written(  o._written ),
+            _blocks(   o._blocks ),
+            _modified( o._modified )
         {}
+        
+        void Image::IMPL::_check( uint64_t offset, uint64_t size ) const
+        {
+            uint64_t available( this->_file->size() );
+            
+            if( offset > available || size > available - offset )
+            {
+                throw std::runtime_error( "Invalid offset - Not enough data available" );
+            }
+        }
+        
+        /*
+         * Reads a range of blocks which have not been written, located at
+         * position, relative to offset.
+         */
+        void Image::IMPL::_read( uint64_t offset, uint64_t position, uint64_t size, const std::function< void( uint64_t, const uint8_t *, size_t ) > & handler ) const
+        {
+            this->_file->read
+            (
+                offset + position,
+                numeric_cast< size_t >( size ),
+                [ & ]( uint64_t p, const uint8_t * chunk, size_t length )
+                {
+                    handler( position + p, chunk, length );
+                }
+            );
+        }
+        
+        /*
+         * Copy of the file's data, ignoring the overlay.
+         */
+        std::vector< uint8_t > Image::IMPL::_read( uint64_t offset, uint64_t size ) const
+        {
+            std::vector< uint8_t > data( numeric_cast< size_t >( size ) );
+            
+            this->_file->read
+            (
+                offset,
+                data.size(),
+                [ & ]( uint64_t position, const uint8_t * bytes, size_t length )
+                {
+                    memcpy( data.data() + position, bytes, length );
+                }
+            );
+            
+            return data;
+        }
     }
 }
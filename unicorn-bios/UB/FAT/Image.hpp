@@ -30,6 +30,7 @@
 #include <string>
 #include <cstdint>
 #include <vector>
+#include <functional>
 #include "UB/FAT/MBR.hpp"
 
 namespace UB
@@ -40,7 +41,12 @@ namespace UB
         {
             public:
                 
-                Image( const std::string & path );
+                /*
+                 * By default, the image file is memory-mapped.
+                 * With a non-zero cache size, it's read on demand, using a
+                 * block cache bounded by the given size, in bytes.
+                 */
+                Image( const std::string & path, size_t cacheSize = 0 );
                 Image( const Image & o );
                 Image( Image && o ) noexcept;
                 ~Image( void );
@@ -49,9 +55,32 @@ namespace UB
                 
                 std::string path( void ) const;
                 MBR         mbr( void )  const;
+                uint64_t    size( void ) const;
                 
-                std::vector< uint8_t > read( uint8_t cylinder, uint8_t head, uint8_t sector, uint8_t sectors = 1 );
-                std::vector< uint8_t > read( uint64_t offset, uint64_t size );
+                std::vector< uint8_t > read( uint8_t cylinder, uint8_t head, uint8_t sector, uint8_t sectors = 1 ) const;
+                std::vector< uint8_t > read( uint64_t offset, uint64_t size )                                      const;
+                
+                /*
+                 * Calls the handler with contiguous chunks of data covering
+                 * the requested range, without copying them.
+                 * Chunks point either to the image's storage, which is shared
+                 * by all copies of the image, or to overwritten blocks, and
+                 * are only valid during the handler's call.
+                 * The handler receives the chunk's position relative to the
+                 * requested offset.
+                 * Throws if the requested range is not entirely available.
+                 */
+                void read( uint64_t offset, uint64_t size, const std::function< void( uint64_t, const uint8_t *, size_t ) > & handler ) const;
+                
+                /*
+                 * Writes never modify the image file.
+                 * Written blocks are kept in a copy-on-write overlay, which
+                 * is discarded with the image, unless it's committed.
+                 */
+                void write( uint64_t offset, const uint8_t * data, uint64_t size );
+                
+                bool modified( void ) const;
+                void commit( void );
                 
                 friend void swap( Image & o1, Image & o2 );
                 
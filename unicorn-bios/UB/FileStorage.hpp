@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#ifndef UB_FILE_STORAGE_HPP
+#define UB_FILE_STORAGE_HPP
+
+#include <string>
+#include <cstdint>
+#include <functional>
+
+namespace UB
+{
+    /*
+     * Read-only access to a file's content, without copies.
+     */
+    class FileStorage
+    {
+        public:
+            
+            virtual ~FileStorage( void ) = default;
+            
+            virtual std::string path( void ) const = 0;
+            virtual size_t      size( void ) const = 0;
+            
+            /*
+             * Calls the handler with contiguous chunks of data covering the
+             * requested range, along with their position relative to the
+             * requested offset.
+             * Chunks are only valid during the handler's call.
+             * The range must be available.
+             */
+            virtual void read( uint64_t offset, size_t size, const std::function< void( uint64_t, const uint8_t *, size_t ) > & handler ) const = 0;
+    };
+}
+
+#endif /* UB_FILE_STORAGE_HPP */
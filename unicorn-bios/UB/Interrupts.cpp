@@ -73,12 +73,19 @@ namespace UB
             return false;
         }
         
-        bool int0x13( const Machine & machine, Engine & engine )
+        bool int0x13( Machine & machine, Engine & engine )
         {
             switch( engine.ah() )
             {
                 case 0x00: return BIOS::Disk::reset( machine, engine );
                 case 0x02: return BIOS::Disk::readSectors( machine, engine );
+                case 0x03: return BIOS::Disk::writeSectors( machine, engine );
+                case 0x41: return BIOS::Disk::checkExtensions( machine, engine );
+                case 0x42: return BIOS::Disk::extendedReadSectors( machine, engine );
+                case 0x43: return BIOS::Disk::extendedWriteSectors( machine, engine );
+                case 0x44: return BIOS::Disk::verifySectors( machine, engine );
+                case 0x47: return BIOS::Disk::extendedSeek( machine, engine );
+                case 0x48: return BIOS::Disk::getDriveParameters( machine, engine );
                 default:   break;
             }
             
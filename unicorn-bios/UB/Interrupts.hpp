@@ -36,7 +36,7 @@ namespace UB
         bool int0x10( const Machine & machine, Engine & engine );
         bool int0x11( const Machine & machine, Engine & engine );
         bool int0x12( const Machine & machine, Engine & engine );
-        bool int0x13( const Machine & machine, Engine & engine );
+        bool int0x13( Machine & machine, Engine & engine );
         bool int0x14( const Machine & machine, Engine & engine );
         bool int0x15( const Machine & machine, Engine & engine );
         bool int0x16( const Machine & machine, Engine & engine );
@@ -29,11 +29,23 @@
 #include "UB/FAT/MBR.hpp"
 #include "UB/String.hpp"
 #include "UB/CPU/Functions.hpp"
+#include "UB/Signal.hpp"
+#include "UB/TraceRecorder.hpp"
+#include "UB/Coverage.hpp"
+#include "UB/Profiler.hpp"
+#include "UB/Capstone.hpp"
 #include <sstream>
 #include <atomic>
 #include <csignal>
 #include <vector>
 #include <iostream>
+#include <chrono>
+#include <optional>
+#include <mutex>
+#include <array>
+#include <unordered_map>
+#include <thread>
+#include <condition_variable>
 
 namespace UB
 {
@@ -41,14 +53,33 @@ namespace UB
     {
         public:
             
-            IMPL( size_t memory, const FAT::Image & fat, UI::Mode mode );
+            IMPL( size_t memory, const FAT::Image & fat, UI::Mode mode, const std::string & memoryFile );
             IMPL( const IMPL & o );
             ~IMPL( void );
             
             static size_t memorySizeOrDefault( size_t memory );
             
-            void _setup( const Machine & machine );
+            void _setup( Machine & machine );
             void _break( const std::string & message = "" );
+            void _updateInstructionHandlers( void );
+            void _scanCPUID( uint64_t address, size_t size );
+            void _patchCPUID( uint64_t address );
+            void   _startBenchmark( void );
+            void   _runBenchmark( void );
+            size_t _countInstructions( uint64_t address, size_t size );
+            void   _reportBenchmark( void );
+            void _reportStats( void );
+            void _reportTrace( void );
+            void _reportCoverage( void );
+            void _reportProfile( void );
+            
+            static constexpr size_t ProfileReportSize = 20;
+            
+            /*
+             * The benchmark alternates between phases of this duration,
+             * with and without an instruction hook.
+             */
+            static constexpr std::chrono::milliseconds BenchmarkPhase = std::chrono::milliseconds( 500 );
             
             size_t                  _memory;
             FAT::Image              _fat;
@@ -61,11 +92,74 @@ namespace UB
             std::atomic< bool >     _trap;
             std::atomic< bool >     _debugVideo;
             std::atomic< bool >     _singleStep;
-            std::vector< uint64_t > _breakpoints;
+            std::atomic< bool >     _benchmark;
+            std::atomic< bool >     _nativeCPUID;
+            std::atomic< uint64_t > _instructions;
+            std::string             _tracePath;
+            bool                    _traceRegisters;
+            bool                    _traceWrites;
+            std::string             _coverageDrcov;
+            std::string             _coverageList;
+            bool                    _profile;
+            
+            std::unique_ptr< TraceRecorder > _trace;
+            std::unique_ptr< Coverage >      _coverage;
+            std::shared_ptr< Profiler >      _profiler;
+            
+            /*
+             * Breakpoints are grouped by blocks of 256 bytes, keyed by linear
+             * address.
+             * Each block has its own execute handler in the engine, so only
+             * instructions located in a block containing breakpoints are
+             * checked, using the block's bitmap.
+             */
+            static constexpr uint64_t BreakpointBlockSize = 256;
+            
+            class BreakpointBlock
+            {
+                public:
+                    
+                    std::array< std::atomic< uint64_t >, BreakpointBlockSize / 64 > bits;
+                    size_t                                                           count;
+                    uint64_t                                                         handler;
+            };
+            
+            std::unordered_map< uint64_t, std::shared_ptr< BreakpointBlock > > _breakpoints;
+            
+            void _checkBreakpoint( uint64_t address, const BreakpointBlock & block );
+            
+            std::optional< uint64_t > _debugHandler;
+            std::optional< uint64_t > _cpuidHandler;
+            std::recursive_mutex      _rmtx;
+            
+            /*
+             * Execute handlers for each possible CPUID instruction, keyed by
+             * linear address. The pending CPUID and its input registers are
+             * only used by the emulation thread.
+             */
+            std::unordered_map< uint64_t, std::array< uint64_t, 2 > > _cpuidHandlers;
+            std::optional< uint64_t >                                 _cpuidPending;
+            Registers                                                 _cpuidRegisters;
+            
+            std::chrono::steady_clock::time_point _runTime;
+            
+            /*
+             * Benchmark results are indexed by phase: 0 without instruction
+             * hook, 1 with it. They're only used by the benchmark thread
+             * until it's joined.
+             */
+            std::optional< uint64_t >                          _benchmarkHandler;
+            std::unordered_map< uint64_t, size_t >             _benchmarkBlocks;
+            std::thread                                        _benchmarkThread;
+            std::mutex                                         _benchmarkMutex;
+            std::condition_variable                            _benchmarkCV;
+            bool                                               _benchmarkStopped;
+            std::array< uint64_t, 2 >                          _benchmarkInstructions;
+            std::array< std::chrono::duration< double >, 2 >   _benchmarkTime;
     };
 
-    Machine::Machine( size_t memory, const FAT::Image & fat, UI::Mode mode ):
-        impl( std::make_unique< IMPL >( memory, fat, mode ) )
+    Machine::Machine( size_t memory, const FAT::Image & fat, UI::Mode mode, const std::string & memoryFile ):
+        impl( std::make_unique< IMPL >( memory, fat, mode, memoryFile ) )
     {
         this->impl->_setup( *( this ) );
     }
@@ -90,6 +184,11 @@ namespace UB
         return *( this );
     }
     
+    FAT::Image & Machine::bootImage( void )
+    {
+        return this->impl->_fat;
+    }
+    
     const FAT::Image & Machine::bootImage( void ) const
     {
         return this->impl->_fat;
@@ -107,6 +206,45 @@ namespace UB
     
     void Machine::run( void )
     {
+        /*
+         * SIGUSR1 dumps statistics to the debug output, without pausing
+         * the emulation.
+         */
+        Signal::handle
+        (
+            SIGUSR1,
+            [ this ]( int sig )
+            {
+                ( void )sig;
+                
+                this->impl->_reportStats();
+            }
+        );
+        
+        this->impl->_runTime = std::chrono::steady_clock::now();
+        
+        if( this->impl->_benchmark )
+        {
+            this->impl->_startBenchmark();
+        }
+        
+        if( this->impl->_tracePath.length() > 0 )
+        {
+            this->impl->_trace = std::make_unique< TraceRecorder >( this->impl->_engine, this->impl->_tracePath, this->impl->_traceRegisters, this->impl->_traceWrites );
+        }
+        
+        if( this->impl->_coverageDrcov.length() > 0 || this->impl->_coverageList.length() > 0 )
+        {
+            this->impl->_coverage = std::make_unique< Coverage >( this->impl->_engine );
+        }
+        
+        if( this->impl->_profile )
+        {
+            this->impl->_profiler = std::make_shared< Profiler >( this->impl->_engine );
+            
+            this->impl->_ui.profiler( this->impl->_profiler );
+        }
+        
         if( this->impl->_engine.start( 0x7C00 ) == false )
         {
             throw std::runtime_error( "Cannot start engine" );
@@ -115,6 +253,48 @@ namespace UB
         this->impl->_ui.mode( this->impl->_mode );
         this->impl->_ui.run();
         this->impl->_engine.stop();
+        
+        if( this->impl->_benchmark )
+        {
+            this->impl->_engine.waitUntilFinished();
+            this->impl->_reportBenchmark();
+        }
+        
+        if( this->impl->_trace != nullptr )
+        {
+            this->impl->_engine.waitUntilFinished();
+            this->impl->_reportTrace();
+        }
+        
+        if( this->impl->_coverage != nullptr )
+        {
+            this->impl->_engine.waitUntilFinished();
+            this->impl->_reportCoverage();
+        }
+        
+        if( this->impl->_profiler != nullptr )
+        {
+            this->impl->_engine.waitUntilFinished();
+            this->impl->_reportProfile();
+        }
+    }
+    
+    void Machine::trace( const std::string & path, bool registers, bool writes )
+    {
+        this->impl->_tracePath      = path;
+        this->impl->_traceRegisters = registers;
+        this->impl->_traceWrites    = writes;
+    }
+    
+    void Machine::coverage( const std::string & drcov, const std::string & list )
+    {
+        this->impl->_coverageDrcov = drcov;
+        this->impl->_coverageList  = list;
+    }
+    
+    void Machine::profile( bool value )
+    {
+        this->impl->_profile = value;
     }
     
     bool Machine::breakOnInterrupt( void ) const
@@ -142,6 +322,16 @@ namespace UB
         return this->impl->_singleStep;
     }
     
+    bool Machine::benchmark( void ) const
+    {
+        return this->impl->_benchmark;
+    }
+    
+    bool Machine::nativeCPUID( void ) const
+    {
+        return this->impl->_nativeCPUID;
+    }
+    
     void Machine::breakOnInterrupt( bool value )
     {
         this->impl->_breakOnInterrupt = value;
@@ -165,25 +355,91 @@ namespace UB
     void Machine::singleStep( bool value )
     {
         this->impl->_singleStep = value;
+        
+        this->impl->_updateInstructionHandlers();
+    }
+    
+    void Machine::benchmark( bool value )
+    {
+        this->impl->_benchmark = value;
+    }
+    
+    void Machine::nativeCPUID( bool value )
+    {
+        this->impl->_nativeCPUID = value;
+        
+        this->impl->_updateInstructionHandlers();
     }
     
     void Machine::addBreakpoint( uint64_t address )
     {
-        this->impl->_breakpoints.push_back( address );
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        uint64_t                                base( address - ( address % IMPL::BreakpointBlockSize ) );
+        uint64_t                                bit( address % IMPL::BreakpointBlockSize );
+        uint64_t                                mask( static_cast< uint64_t >( 1 ) << ( bit % 64 ) );
+        std::shared_ptr< IMPL::BreakpointBlock > block;
+        
+        {
+            auto it( this->impl->_breakpoints.find( base ) );
+            
+            if( it != this->impl->_breakpoints.end() )
+            {
+                block = it->second;
+            }
+        }
+        
+        if( block == nullptr )
+        {
+            block = std::make_shared< IMPL::BreakpointBlock >();
+            
+            for( auto & bits: block->bits )
+            {
+                bits = 0;
+            }
+            
+            block->count   = 0;
+            block->handler = this->impl->_engine.onExecute
+            (
+                base,
+                base + IMPL::BreakpointBlockSize - 1,
+                [ impl = this->impl.get(), b = block ]( uint64_t ip )
+                {
+                    impl->_checkBreakpoint( ip, *( b ) );
+                }
+            );
+            
+            this->impl->_breakpoints[ base ] = block;
+        }
+        
+        if( ( block->bits[ bit / 64 ].fetch_or( mask ) & mask ) == 0 )
+        {
+            block->count++;
+        }
     }
     
     void Machine::removeBreakpoint( uint64_t address )
     {
-        this->impl->_breakpoints.erase
-        (
-            std::remove
-            (
-                this->impl->_breakpoints.begin(),
-                this->impl->_breakpoints.end(),
-                address
-            ),
-            this->impl->_breakpoints.end()
-        );
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        uint64_t                                base( address - ( address % IMPL::BreakpointBlockSize ) );
+        uint64_t                                bit( address % IMPL::BreakpointBlockSize );
+        uint64_t                                mask( static_cast< uint64_t >( 1 ) << ( bit % 64 ) );
+        auto                                    it( this->impl->_breakpoints.find( base ) );
+        
+        if( it == this->impl->_breakpoints.end() )
+        {
+            return;
+        }
+        
+        if( ( it->second->bits[ bit / 64 ].fetch_and( ~mask ) & mask ) != 0 )
+        {
+            it->second->count--;
+        }
+        
+        if( it->second->count == 0 )
+        {
+            this->impl->_engine.removeExecuteHandler( it->second->handler );
+            this->impl->_breakpoints.erase( it );
+        }
     }
     
     void swap( Machine & o1, Machine & o2 )
@@ -193,18 +449,27 @@ namespace UB
         swap( o1.impl, o2.impl );
     }
 
-    Machine::IMPL::IMPL( size_t memory, const FAT::Image & fat, UI::Mode mode ):
+    Machine::IMPL::IMPL( size_t memory, const FAT::Image & fat, UI::Mode mode, const std::string & memoryFile ):
         _memory(                 memorySizeOrDefault( memory ) ),
         _fat(                    fat ),
         _mode(                   mode ),
-        _engine(                 memorySizeOrDefault( memory ) ),
+        _engine(                 memorySizeOrDefault( memory ), memoryFile ),
         _ui(                     this->_engine ),
         _memoryMap(              memorySizeOrDefault( memory ) ),
         _breakOnInterrupt(       false ),
         _breakOnInterruptReturn( false ),
         _trap(                   false ),
         _debugVideo(             false ),
-        _singleStep(             false )
+        _singleStep(             false ),
+        _benchmark(              false ),
+        _nativeCPUID(            false ),
+        _instructions(           0 ),
+        _traceRegisters(         false ),
+        _traceWrites(            false ),
+        _profile(                false ),
+        _benchmarkStopped(       false ),
+        _benchmarkInstructions(  {} ),
+        _benchmarkTime(          {} )
     {}
 
     Machine::IMPL::IMPL( const IMPL & o ):
@@ -218,11 +483,36 @@ namespace UB
         _breakOnInterruptReturn( o._breakOnInterruptReturn.load() ),
         _trap(                   o._trap.load() ),
         _debugVideo(             o._debugVideo.load() ),
-        _singleStep(             o._singleStep.load() )
+        _singleStep(             o._singleStep.load() ),
+        _benchmark(              o._benchmark.load() ),
+        _nativeCPUID(            o._nativeCPUID.load() ),
+        _instructions(           0 ),
+        _tracePath(              o._tracePath ),
+        _traceRegisters(         o._traceRegisters ),
+        _traceWrites(            o._traceWrites ),
+        _coverageDrcov(          o._coverageDrcov ),
+        _coverageList(           o._coverageList ),
+        _profile(                o._profile ),
+        _benchmarkStopped(       false ),
+        _benchmarkInstructions(  {} ),
+        _benchmarkTime(          {} )
     {}
 
     Machine::IMPL::~IMPL( void )
-    {}
+    {
+        if( this->_benchmarkThread.joinable() )
+        {
+            {
+                std::lock_guard< std::mutex > l( this->_benchmarkMutex );
+                
+                this->_benchmarkStopped = true;
+                
+                this->_benchmarkCV.notify_all();
+            }
+            
+            this->_benchmarkThread.join();
+        }
+    }
     
     size_t Machine::IMPL::memorySizeOrDefault( size_t memory )
     {
@@ -238,7 +528,7 @@ namespace UB
         return memory * 1024 * 1024;
     }
     
-    void Machine::IMPL::_setup( const Machine & machine )
+    void Machine::IMPL::_setup( Machine & machine )
     {
         FAT::MBR               mbr( this->_fat.mbr() );
         std::vector< uint8_t > mbrData( mbr.data() );
@@ -260,46 +550,7 @@ namespace UB
             }
         );
         
-        this->_engine.beforeInstruction
-        (
-            [ & ]( uint64_t address, const std::vector< uint8_t > & instruction )
-            {
-                ( void )address;
-                ( void )instruction;
-                
-                if( this->_singleStep )
-                {
-                    this->_break();
-                }
-                else
-                {
-                    uint64_t ip( this->_engine.eip() );
-                    
-                    if( std::find( this->_breakpoints.begin(), this->_breakpoints.end(), ip ) != this->_breakpoints.end() )
-                    {
-                        this->_break( String::toHex( ip ) );
-                    }
-                }
-            }
-        );
-        
-        this->_engine.afterInstruction
-        (
-            [ & ]( uint64_t address, const Registers & registers, const std::vector< uint8_t > & instruction )
-            {
-                ( void )address;
-                
-                if
-                (
-                       instruction.size() == 2
-                    && instruction[ 0 ]   == 0x0F
-                    && instruction[ 1 ]   == 0xA2
-                )
-                {
-                    CPU::cpuid( this->_engine, registers );
-                }
-            }
-        );
+        this->_updateInstructionHandlers();
         
         this->_engine.onInterrupt
         (
@@ -339,31 +590,20 @@ namespace UB
             }
         );
         
-        this->_engine.onValidMemoryAccess
-        (
-            [ & ]( uint64_t address, size_t size )
+        /*
+         * Reserved regions are read-only for the emulated code, so writes
+         * and instruction fetches end up in the invalid memory access
+         * handler.
+         */
+        for( const auto & entry: this->_memoryMap.entries() )
+        {
+            if( entry.type() == BIOS::MemoryMap::Entry::Type::Usable || entry.base() >= this->_memory )
             {
-                if( this->_engine.running() == false )
-                {
-                    return;
-                }
-                
-                for( const auto & entry: this->_memoryMap.entries() )
-                {
-                    uint64_t end( address + size );
-                    
-                    if( entry.type() == BIOS::MemoryMap::Entry::Type::Usable )
-                    {
-                        continue;
-                    }
-                    
-                    if( ( address >= entry.base() && address <= entry.end() ) || ( end >= entry.base() && end <= entry.end() ) )
-                    {
-                        throw std::runtime_error( "Access to invalid memory at address " + String::toHex( address ) );
-                    }
-                }
+                continue;
             }
-        );
+            
+            this->_engine.protect( entry.base(), std::min( entry.length(), this->_memory - entry.base() ) );
+        }
         
         this->_engine.onInvalidMemoryAccess
         (
@@ -384,6 +624,8 @@ namespace UB
                     if( key == 0x20 )
                     {
                         this->_singleStep = true;
+                        
+                        this->_updateInstructionHandlers();
                     }
                 }
             );
@@ -403,6 +645,8 @@ namespace UB
         }
         else
         {
+            this->_engine.publishRegisters();
+            
             if( this->_ui.waitForUserResume() == 0x20 )
             {
                 this->_singleStep = true;
@@ -411,6 +655,401 @@ namespace UB
             {
                 this->_singleStep = false;
             }
+            
+            this->_updateInstructionHandlers();
         }
     }
+    
+    void Machine::IMPL::_updateInstructionHandlers( void )
+    {
+        std::lock_guard< std::recursive_mutex > l( this->_rmtx );
+        
+        /*
+         * Instruction handlers slow down the emulation considerably, so
+         * they are only registered while single-stepping.
+         * CPUID results are patched by execute handlers, only covering the
+         * CPUID instructions found in executed blocks.
+         */
+        bool debug( this->_singleStep );
+        bool cpuid( this->_nativeCPUID == false );
+        
+        if( debug && this->_debugHandler.has_value() == false )
+        {
+            this->_debugHandler = this->_engine.beforeInstruction
+            (
+                [ & ]( uint64_t address, const std::vector< uint8_t > & instruction )
+                {
+                    ( void )address;
+                    ( void )instruction;
+                    
+                    if( this->_singleStep )
+                    {
+                        this->_break();
+                    }
+                }
+            );
+        }
+        else if( debug == false && this->_debugHandler.has_value() )
+        {
+            this->_engine.removeInstructionHandler( this->_debugHandler.value() );
+            this->_debugHandler.reset();
+        }
+        
+        if( cpuid && this->_cpuidHandler.has_value() == false )
+        {
+            this->_cpuidHandler = this->_engine.onBlock
+            (
+                [ & ]( uint64_t address, size_t size )
+                {
+                    this->_scanCPUID( address, size );
+                }
+            );
+        }
+        else if( cpuid == false && this->_cpuidHandler.has_value() )
+        {
+            this->_engine.removeBlockHandler( this->_cpuidHandler.value() );
+            this->_cpuidHandler.reset();
+            
+            for( const auto & p: this->_cpuidHandlers )
+            {
+                this->_engine.removeExecuteHandler( p.second[ 0 ] );
+                this->_engine.removeExecuteHandler( p.second[ 1 ] );
+            }
+            
+            this->_cpuidHandlers.clear();
+        }
+    }
+    
+    /*
+     * Called by the emulation thread for every executed block.
+     * Blocks are scanned every time, as code may be overwritten, but only
+     * blocks containing the CPUID opcode take the lock.
+     * The opcode may also be part of another instruction, in which case
+     * its handlers are simply never called.
+     */
+    void Machine::IMPL::_scanCPUID( uint64_t address, size_t size )
+    {
+        const uint8_t * code;
+        
+        if( size < 2 || address >= this->_memory || size > this->_memory - address )
+        {
+            return;
+        }
+        
+        code = this->_engine.view( address, size );
+        
+        for( size_t i = 0; i < size - 1; i++ )
+        {
+            if( code[ i ] != 0x0F || code[ i + 1 ] != 0xA2 )
+            {
+                continue;
+            }
+            
+            {
+                std::lock_guard< std::recursive_mutex > l( this->_rmtx );
+                uint64_t                                cpuid( address + i );
+                
+                if( this->_cpuidHandler.has_value() == false || this->_cpuidHandlers.count( cpuid ) > 0 )
+                {
+                    continue;
+                }
+                
+                /*
+                 * Registers are saved before the instruction, and results
+                 * are patched before the next one.
+                 * Installing the handlers restarts the emulation at the
+                 * start of the current block, so they're not missed.
+                 */
+                this->_cpuidHandlers[ cpuid ] =
+                {
+                    this->_engine.onExecute
+                    (
+                        cpuid,
+                        cpuid,
+                        [ & ]( uint64_t ip, size_t length )
+                        {
+                            const uint8_t * bytes( this->_engine.view( ip, 2 ) );
+                            
+                            if( length == 2 && bytes[ 0 ] == 0x0F && bytes[ 1 ] == 0xA2 )
+                            {
+                                this->_cpuidPending   = ip;
+                                this->_cpuidRegisters = Registers( this->_engine.hookSnapshot() );
+                            }
+                        }
+                    ),
+                    this->_engine.onExecute
+                    (
+                        cpuid + 2,
+                        cpuid + 2,
+                        [ & ]( uint64_t ip )
+                        {
+                            this->_patchCPUID( ip - 2 );
+                        }
+                    )
+                };
+            }
+        }
+    }
+    
+    void Machine::IMPL::_patchCPUID( uint64_t address )
+    {
+        if( this->_cpuidPending.has_value() == false || this->_cpuidPending.value() != address )
+        {
+            return;
+        }
+        
+        this->_cpuidPending.reset();
+        
+        CPU::cpuid( this->_engine, this->_cpuidRegisters );
+    }
+    
+    void Machine::IMPL::_checkBreakpoint( uint64_t address, const BreakpointBlock & block )
+    {
+        uint64_t bit( address % BreakpointBlockSize );
+        
+        /*
+         * While single-stepping, the instruction handler already breaks on
+         * every instruction.
+         */
+        if( this->_singleStep )
+        {
+            return;
+        }
+        
+        if( ( block.bits[ bit / 64 ] & ( static_cast< uint64_t >( 1 ) << ( bit % 64 ) ) ) != 0 )
+        {
+            this->_break( String::toHex( address ) );
+        }
+    }
+    
+    void Machine::IMPL::_startBenchmark( void )
+    {
+        this->_instructions     = 0;
+        this->_benchmarkStopped = false;
+        
+        /*
+         * Instructions are counted per block, so counting doesn't require
+         * an instruction hook.
+         */
+        this->_benchmarkHandler = this->_engine.onBlock
+        (
+            [ & ]( uint64_t address, size_t size )
+            {
+                this->_instructions += this->_countInstructions( address, size );
+            }
+        );
+        
+        this->_engine.onStop
+        (
+            [ & ]
+            {
+                std::lock_guard< std::mutex > l( this->_benchmarkMutex );
+                
+                this->_benchmarkStopped = true;
+                
+                this->_benchmarkCV.notify_all();
+            }
+        );
+        
+        this->_benchmarkThread = std::thread( [ & ] { this->_runBenchmark(); } );
+    }
+    
+    /*
+     * Alternates between free running and running with an instruction
+     * hook, which doesn't do anything, so both speeds are measured on the
+     * same code.
+     */
+    void Machine::IMPL::_runBenchmark( void )
+    {
+        std::unique_lock< std::mutex >        l( this->_benchmarkMutex );
+        std::optional< uint64_t >             hook;
+        std::chrono::steady_clock::time_point start( std::chrono::steady_clock::now() );
+        uint64_t                              instructions( 0 );
+        
+        while( true )
+        {
+            bool     stopped( this->_benchmarkCV.wait_for( l, BenchmarkPhase, [ & ] { return this->_benchmarkStopped; } ) );
+            auto     now( std::chrono::steady_clock::now() );
+            uint64_t count( this->_instructions );
+            size_t   phase( ( hook.has_value() ) ? 1 : 0 );
+            
+            this->_benchmarkInstructions[ phase ] += count - instructions;
+            this->_benchmarkTime[ phase ]         += now - start;
+            
+            if( stopped )
+            {
+                break;
+            }
+            
+            /*
+             * The engine's lock is held while stop handlers are called, so
+             * it can't be taken while holding the benchmark's lock.
+             */
+            l.unlock();
+            
+            if( hook.has_value() )
+            {
+                this->_engine.removeInstructionHandler( hook.value() );
+                hook.reset();
+            }
+            else
+            {
+                hook = this->_engine.beforeInstruction
+                (
+                    []( uint64_t address, const std::vector< uint8_t > & instruction )
+                    {
+                        ( void )address;
+                        ( void )instruction;
+                    }
+                );
+            }
+            
+            l.lock();
+            
+            start        = std::chrono::steady_clock::now();
+            instructions = this->_instructions;
+        }
+        
+        l.unlock();
+        
+        if( hook.has_value() )
+        {
+            this->_engine.removeInstructionHandler( hook.value() );
+        }
+    }
+    
+    /*
+     * Called by the emulation thread for every executed block.
+     * Blocks are only disassembled the first time they're executed, and
+     * are identified by their address and size.
+     */
+    size_t Machine::IMPL::_countInstructions( uint64_t address, size_t size )
+    {
+        uint64_t key( ( address << 16 ) | std::min< size_t >( size, 0xFFFF ) );
+        auto     it( this->_benchmarkBlocks.find( key ) );
+        size_t   count( 0 );
+        
+        if( it != this->_benchmarkBlocks.end() )
+        {
+            return it->second;
+        }
+        
+        if( size > 0 && address < this->_memory && size <= this->_memory - address )
+        {
+            count = Capstone::instructions( this->_engine.view( address, size ), size, address ).size();
+        }
+        
+        this->_benchmarkBlocks[ key ] = count;
+        
+        return count;
+    }
+    
+    void Machine::IMPL::_reportBenchmark( void )
+    {
+        std::array< double, 2 > speeds( {} );
+        
+        if( this->_benchmarkThread.joinable() )
+        {
+            this->_benchmarkThread.join();
+        }
+        
+        if( this->_benchmarkHandler.has_value() )
+        {
+            this->_engine.removeBlockHandler( this->_benchmarkHandler.value() );
+            this->_benchmarkHandler.reset();
+        }
+        
+        for( size_t i = 0; i < speeds.size(); i++ )
+        {
+            double seconds( this->_benchmarkTime[ i ].count() );
+            
+            speeds[ i ] = ( seconds > 0 ) ? static_cast< double >( this->_benchmarkInstructions[ i ] ) / seconds : 0;
+        }
+        
+        std::cerr << "Benchmark:"
+                  << std::endl
+                  << "    - Instructions:     " << this->_instructions.load()
+                  << std::endl
+                  << "    - Blocks:           " << this->_benchmarkBlocks.size()
+                  << std::endl
+                  << "    - Time:             " << ( this->_benchmarkTime[ 0 ] + this->_benchmarkTime[ 1 ] ).count() << " s"
+                  << std::endl
+                  << "    - Instruction hook: " << static_cast< uint64_t >( speeds[ 1 ] ) << " instructions/s"
+                  << std::endl
+                  << "    - Free run:         " << static_cast< uint64_t >( speeds[ 0 ] ) << " instructions/s"
+                  << std::endl;
+    }
+    
+    void Machine::IMPL::_reportTrace( void )
+    {
+        this->_trace->stop();
+        
+        std::cerr << "Trace:"
+                  << std::endl
+                  << "    - File:         " << this->_trace->path()
+                  << std::endl
+                  << "    - Instructions: " << this->_trace->instructions()
+                  << std::endl
+                  << "    - Dropped:      " << this->_trace->dropped()
+                  << std::endl
+                  << "    - Lost writes:  " << this->_trace->droppedWrites()
+                  << std::endl;
+        
+        this->_trace.reset();
+    }
+    
+    void Machine::IMPL::_reportCoverage( void )
+    {
+        this->_coverage->stop();
+        
+        if( this->_coverageDrcov.length() > 0 )
+        {
+            this->_coverage->drcov( this->_coverageDrcov, this->_fat.path() );
+        }
+        
+        if( this->_coverageList.length() > 0 )
+        {
+            this->_coverage->list( this->_coverageList );
+        }
+        
+        std::cerr << "Coverage:"
+                  << std::endl
+                  << "    - Blocks:       " << this->_coverage->blocks().size()
+                  << std::endl
+                  << "    - Bytes:        " << this->_coverage->bytes()
+                  << std::endl;
+        
+        this->_coverage.reset();
+    }
+    
+    void Machine::IMPL::_reportProfile( void )
+    {
+        this->_profiler->stop();
+        this->_profiler->report( std::cerr, ProfileReportSize );
+        this->_ui.profiler( nullptr );
+        this->_profiler.reset();
+    }
+    
+    void Machine::IMPL::_reportStats( void )
+    {
+        std::chrono::duration< double > elapsed( std::chrono::steady_clock::now() - this->_runTime );
+        Registers                       registers( this->_engine.registers() );
+        std::stringstream               ss;
+        
+        ss << "[ STATS ]> "
+           << ( this->_engine.running() ? "Running" : "Stopped" )
+           << " - Time: " << elapsed.count() << " s"
+           << " - CS:IP: " << String::toHex( registers.cs() ) << ":" << String::toHex( registers.ip() );
+        
+        /*
+         * Instructions are only counted in benchmark mode, as it requires
+         * a block handler.
+         */
+        if( this->_benchmark )
+        {
+            ss << " - Instructions: " << this->_instructions.load();
+        }
+        
+        this->_ui.debug() << ss.str() << std::endl;
+    }
 }
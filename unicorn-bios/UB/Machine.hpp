@@ -37,13 +37,14 @@ namespace UB
     {
         public:
             
-            Machine( size_t memory, const FAT::Image & fat, UI::Mode mode );
+            Machine( size_t memory, const FAT::Image & fat, UI::Mode mode, const std::string & memoryFile = "" );
             Machine( const Machine & o );
             Machine( Machine && o ) noexcept;
             ~Machine( void );
             
             Machine & operator =( Machine o );
             
+            FAT::Image            & bootImage( void );
             const FAT::Image      & bootImage( void ) const;
             const BIOS::MemoryMap & memoryMap( void ) const;
             
@@ -56,12 +57,36 @@ namespace UB
             bool trap( void )                   const;
             bool debugVideo( void )             const;
             bool singleStep( void )             const;
+            bool benchmark( void )              const;
+            bool nativeCPUID( void )            const;
             
             void breakOnInterrupt( bool value );
             void breakOnInterruptReturn( bool value );
             void trap( bool value );
             void debugVideo( bool value );
             void singleStep( bool value );
+            void benchmark( bool value );
+            void nativeCPUID( bool value );
+            
+            /*
+             * Records executed instructions to a file while running,
+             * optionally with registers and memory writes.
+             * An empty path disables tracing.
+             */
+            void trace( const std::string & path, bool registers = false, bool writes = false );
+            
+            /*
+             * Collects executed basic blocks while running, and writes them
+             * at exit as a drcov file and/or as a list of addresses.
+             * Empty paths disable the corresponding output.
+             */
+            void coverage( const std::string & drcov, const std::string & list );
+            
+            /*
+             * Samples executed basic blocks while running, showing the
+             * hottest ones in the user interface, and reporting them at exit.
+             */
+            void profile( bool value );
             
             void addBreakpoint(    uint64_t address );
             void removeBreakpoint( uint64_t address );
@@ -0,0 +1,135 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#include "UB/MappedFile.hpp"
+#include "UB/Casts.hpp"
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace UB
+{
+    class MappedFile::IMPL
+    {
+        public:
+            
+            IMPL( const std::string & path );
+            ~IMPL( void );
+            
+            std::string _path;
+            size_t      _size;
+            uint8_t   * _data;
+    };
+    
+    MappedFile::MappedFile( const std::string & path ):
+        impl( std::make_unique< IMPL >( path ) )
+    {}
+    
+    MappedFile::~MappedFile( void )
+    {}
+    
+    std::string MappedFile::path( void ) const
+    {
+        return this->impl->_path;
+    }
+    
+    size_t MappedFile::size( void ) const
+    {
+        return this->impl->_size;
+    }
+    
+    const uint8_t * MappedFile::data( void ) const
+    {
+        return this->impl->_data;
+    }
+    
+    void MappedFile::read( uint64_t offset, size_t size, const std::function< void( uint64_t, const uint8_t *, size_t ) > & handler ) const
+    {
+        if( offset > this->impl->_size || size > this->impl->_size - offset )
+        {
+            throw std::runtime_error( "Invalid read - Not enough data available" );
+        }
+        
+        if( size > 0 )
+        {
+            handler( 0, this->impl->_data + offset, size );
+        }
+    }
+    
+    MappedFile::IMPL::IMPL( const std::string & path ):
+        _path( path ),
+        _size( 0 ),
+        _data( nullptr )
+    {
+        int         fd;
+        struct stat st;
+        
+        if( ( fd = open( path.c_str(), O_RDONLY ) ) == -1 )
+        {
+            throw std::runtime_error( "Cannot open file: " + path );
+        }
+        
+        if( fstat( fd, &st ) != 0 )
+        {
+            close( fd );
+            
+            throw std::runtime_error( "Cannot get file size: " + path );
+        }
+        
+        this->_size = numeric_cast< size_t >( st.st_size );
+        
+        /*
+         * Empty files cannot be mapped, and have no data.
+         */
+        if( this->_size > 0 )
+        {
+            void * data( mmap( nullptr, this->_size, PROT_READ, MAP_PRIVATE, fd, 0 ) );
+            
+            if( data == MAP_FAILED )
+            {
+                close( fd );
+                
+                throw std::runtime_error( "Cannot map file: " + path );
+            }
+            
+            this->_data = static_cast< uint8_t * >( data );
+        }
+        
+        /*
+         * The mapping stays valid once the file descriptor is closed.
+         */
+        close( fd );
+    }
+    
+    MappedFile::IMPL::~IMPL( void )
+    {
+        if( this->_data != nullptr )
+        {
+            munmap( this->_data, this->_size );
+        }
+    }
+}
@@ -0,0 +1,67 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#ifndef UB_MAPPED_FILE_HPP
+#define UB_MAPPED_FILE_HPP
+
+#include <memory>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+#include "UB/FileStorage.hpp"
+
+namespace UB
+{
+    /*
+     * Read-only memory mapping of a whole file.
+     * Mappings are not copyable, and are meant to be shared (using a
+     * shared pointer) by the objects accessing the file's content.
+     */
+    class MappedFile: public FileStorage
+    {
+        public:
+            
+            MappedFile( const std::string & path );
+            ~MappedFile( void ) override;
+            
+            MappedFile( const MappedFile & o )              = delete;
+            MappedFile( MappedFile && o )                   = delete;
+            MappedFile & operator =( const MappedFile & o ) = delete;
+            MappedFile & operator =( MappedFile && o )      = delete;
+            
+            std::string     path( void ) const override;
+            size_t          size( void ) const override;
+            const uint8_t * data( void ) const;
+            
+            void read( uint64_t offset, size_t size, const std::function< void( uint64_t, const uint8_t *, size_t ) > & handler ) const override;
+            
+        private:
+            
+            class IMPL;
+            std::unique_ptr< IMPL > impl;
+    };
+}
+
+#endif /* UB_MAPPED_FILE_HPP */
@@ -0,0 +1,356 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "UB/Profiler.hpp"
+#include "UB/Engine.hpp"
+#include "UB/Capstone.hpp"
+#include "UB/String.hpp"
+#include <atomic>
+#include <thread>
+#include <optional>
+#include <algorithm>
+#include <iomanip>
+
+namespace UB
+{
+    class Profiler::IMPL
+    {
+        public:
+            
+            /*
+             * Keys are block addresses plus one, so zero marks an empty
+             * entry. An entry's key is published last, so readers never see
+             * a partially initialized entry.
+             */
+            class Entry
+            {
+                public:
+                    
+                    std::atomic< uint64_t > key;
+                    std::atomic< uint32_t > size;
+                    std::atomic< uint64_t > executions;
+                    std::atomic< uint64_t > samples;
+            };
+            
+            IMPL( Engine & engine, size_t capacity, std::chrono::microseconds interval );
+            ~IMPL( void );
+            
+            void    _record( uint64_t address, size_t size );
+            Entry * _find( uint64_t address, size_t size );
+            void    _tick( void );
+            void    _stop( void );
+            
+            static void _increment( std::atomic< uint64_t > & value );
+            
+            Engine                     & _engine;
+            std::unique_ptr< Entry[] >   _entries;
+            size_t                       _capacity;
+            size_t                       _used;
+            std::chrono::microseconds    _interval;
+            std::optional< uint64_t >    _handler;
+            std::thread                  _timer;
+            std::atomic< bool >          _stopping;
+            std::atomic< bool >          _sample;
+            std::atomic< uint64_t >      _samples;
+            std::atomic< uint64_t >      _executions;
+            std::atomic< uint64_t >      _overflow;
+    };
+    
+    Profiler::Profiler( Engine & engine, size_t capacity, std::chrono::microseconds interval ):
+        impl( std::make_unique< IMPL >( engine, capacity, interval ) )
+    {}
+    
+    Profiler::~Profiler( void )
+    {}
+    
+    void Profiler::stop( void )
+    {
+        this->impl->_stop();
+    }
+    
+    uint64_t Profiler::samples( void ) const
+    {
+        return this->impl->_samples;
+    }
+    
+    uint64_t Profiler::executions( void ) const
+    {
+        return this->impl->_executions;
+    }
+    
+    uint64_t Profiler::overflow( void ) const
+    {
+        return this->impl->_overflow;
+    }
+    
+    std::vector< Profiler::HotSpot > Profiler::top( size_t count ) const
+    {
+        std::vector< HotSpot > spots;
+        
+        for( size_t i = 0; i < this->impl->_capacity; i++ )
+        {
+            const IMPL::Entry & entry( this->impl->_entries[ i ] );
+            uint64_t            key( entry.key.load( std::memory_order_acquire ) );
+            
+            if( key == 0 )
+            {
+                continue;
+            }
+            
+            spots.push_back
+            (
+                {
+                    static_cast< uint32_t >( key - 1 ),
+                    entry.size.load( std::memory_order_relaxed ),
+                    entry.executions.load( std::memory_order_relaxed ),
+                    entry.samples.load( std::memory_order_relaxed )
+                }
+            );
+        }
+        
+        count = std::min( count, spots.size() );
+        
+        std::partial_sort
+        (
+            spots.begin(),
+            spots.begin() + static_cast< ssize_t >( count ),
+            spots.end(),
+            []( const HotSpot & s1, const HotSpot & s2 ) -> bool
+            {
+                if( s1.samples != s2.samples )
+                {
+                    return s1.samples > s2.samples;
+                }
+                
+                return s1.executions > s2.executions;
+            }
+        );
+        
+        spots.resize( count );
+        
+        return spots;
+    }
+    
+    void Profiler::report( std::ostream & os, size_t count ) const
+    {
+        uint64_t samples( this->impl->_samples );
+        
+        os << "Profile:"
+           << std::endl
+           << "    - Samples:      " << samples
+           << std::endl
+           << "    - Blocks:       " << this->impl->_executions
+           << std::endl
+           << "    - Overflow:     " << this->impl->_overflow
+           << std::endl;
+        
+        for( const auto & spot: this->top( count ) )
+        {
+            double percent( ( samples > 0 ) ? ( static_cast< double >( spot.samples ) * 100.0 ) / static_cast< double >( samples ) : 0.0 );
+            
+            os << std::endl
+               << "    " << String::toHex( spot.address )
+               << " - " << std::fixed << std::setprecision( 1 ) << percent << "%"
+               << " - Samples: " << spot.samples
+               << " - Executions: " << spot.executions
+               << std::endl;
+            
+            try
+            {
+                for( const auto & instruction: Capstone::disassemble( this->impl->_engine.view( spot.address, spot.size ), spot.size, spot.address ) )
+                {
+                    os << "        " << instruction.first << ": " << instruction.second << std::endl;
+                }
+            }
+            catch( ... )
+            {}
+        }
+    }
+    
+    Profiler::IMPL::IMPL( Engine & engine, size_t capacity, std::chrono::microseconds interval ):
+        _engine(     engine ),
+        _capacity(   1 ),
+        _used(       0 ),
+        _interval(   interval ),
+        _stopping(   false ),
+        _sample(     false ),
+        _samples(    0 ),
+        _executions( 0 ),
+        _overflow(   0 )
+    {
+        /*
+         * The capacity is a power of two, so hashes can be masked.
+         */
+        while( this->_capacity < capacity )
+        {
+            this->_capacity *= 2;
+        }
+        
+        this->_entries = std::make_unique< Entry[] >( this->_capacity );
+        
+        for( size_t i = 0; i < this->_capacity; i++ )
+        {
+            this->_entries[ i ].key        = 0;
+            this->_entries[ i ].size       = 0;
+            this->_entries[ i ].executions = 0;
+            this->_entries[ i ].samples    = 0;
+        }
+        
+        this->_handler = this->_engine.onBlock
+        (
+            [ this ]( uint64_t address, size_t size )
+            {
+                this->_record( address, size );
+            }
+        );
+        
+        /*
+         * The timer is started last, so it never has to be stopped if
+         * construction fails, but the handler must then be removed.
+         */
+        try
+        {
+            this->_timer = std::thread( [ this ] { this->_tick(); } );
+        }
+        catch( ... )
+        {
+            this->_engine.removeBlockHandler( this->_handler.value() );
+            
+            throw;
+        }
+    }
+    
+    Profiler::IMPL::~IMPL( void )
+    {
+        this->_stop();
+    }
+    
+    void Profiler::IMPL::_stop( void )
+    {
+        if( this->_handler.has_value() )
+        {
+            this->_engine.removeBlockHandler( this->_handler.value() );
+            this->_handler.reset();
+        }
+        
+        this->_stopping = true;
+        
+        if( this->_timer.joinable() )
+        {
+            this->_timer.join();
+        }
+    }
+    
+    void Profiler::IMPL::_tick( void )
+    {
+        while( this->_stopping == false )
+        {
+            std::this_thread::sleep_for( this->_interval );
+            
+            this->_sample.store( true, std::memory_order_relaxed );
+        }
+    }
+    
+    /*
+     * Called by the emulation thread for every executed block.
+     * The emulation thread is the only writer, so counters don't need
+     * atomic read-modify-write operations.
+     */
+    void Profiler::IMPL::_increment( std::atomic< uint64_t > & value )
+    {
+        value.store( value.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+    }
+    
+    void Profiler::IMPL::_record( uint64_t address, size_t size )
+    {
+        Entry * entry( this->_find( address, size ) );
+        bool    sample( this->_sample.load( std::memory_order_relaxed ) && this->_sample.exchange( false, std::memory_order_relaxed ) );
+        
+        _increment( this->_executions );
+        
+        if( sample )
+        {
+            _increment( this->_samples );
+        }
+        
+        if( entry == nullptr )
+        {
+            _increment( this->_overflow );
+            
+            return;
+        }
+        
+        if( size > entry->size.load( std::memory_order_relaxed ) )
+        {
+            entry->size.store( static_cast< uint32_t >( size ), std::memory_order_relaxed );
+        }
+        
+        _increment( entry->executions );
+        
+        if( sample )
+        {
+            _increment( entry->samples );
+        }
+    }
+    
+    /*
+     * Linear probing. The table is never filled above 3/4, so probing
+     * always ends on an empty entry.
+     */
+    Profiler::IMPL::Entry * Profiler::IMPL::_find( uint64_t address, size_t size )
+    {
+        uint64_t key( address + 1 );
+        size_t   mask( this->_capacity - 1 );
+        size_t   i( static_cast< size_t >( ( key * 0x9E3779B97F4A7C15 ) >> 32 ) & mask );
+        
+        while( true )
+        {
+            uint64_t current( this->_entries[ i ].key.load( std::memory_order_relaxed ) );
+            
+            if( current == key )
+            {
+                return &( this->_entries[ i ] );
+            }
+            
+            if( current == 0 )
+            {
+                break;
+            }
+            
+            i = ( i + 1 ) & mask;
+        }
+        
+        if( this->_used >= ( this->_capacity / 4 ) * 3 )
+        {
+            return nullptr;
+        }
+        
+        this->_used++;
+        
+        this->_entries[ i ].size.store( static_cast< uint32_t >( size ), std::memory_order_relaxed );
+        this->_entries[ i ].key.store( key, std::memory_order_release );
+        
+        return &( this->_entries[ i ] );
+    }
+}
@@ -0,0 +1,101 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef UB_PROFILER_HPP
+#define UB_PROFILER_HPP
+
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <chrono>
+#include <ostream>
+
+namespace UB
+{
+    class Engine;
+    
+    /*
+     * Sampling profiler for guest code.
+     * 
+     * Executions are counted per basic block, using the engine's block
+     * hook. A timer thread requests a sample at a fixed interval, which is
+     * taken at the next block boundary, so samples reflect where the
+     * emulation spends its time without stopping it.
+     * Counts are kept in a fixed-size open addressing table, keyed by
+     * linear block address. Once the table is full, new blocks are only
+     * counted as overflow.
+     * 
+     * Counts are written by the emulation thread only, and can be read from
+     * any thread while the emulation is running.
+     */
+    class Profiler
+    {
+        public:
+            
+            static constexpr size_t                    DefaultCapacity = 64 * 1024;
+            static constexpr std::chrono::microseconds DefaultInterval = std::chrono::microseconds( 1000 );
+            
+            class HotSpot
+            {
+                public:
+                    
+                    uint32_t address;
+                    uint32_t size;
+                    uint64_t executions;
+                    uint64_t samples;
+            };
+            
+            Profiler( Engine & engine, size_t capacity = DefaultCapacity, std::chrono::microseconds interval = DefaultInterval );
+            ~Profiler( void );
+            
+            Profiler( const Profiler & o )              = delete;
+            Profiler( Profiler && o )                   = delete;
+            Profiler & operator =( const Profiler & o ) = delete;
+            Profiler & operator =( Profiler && o )      = delete;
+            
+            void stop( void );
+            
+            uint64_t samples( void )    const;
+            uint64_t executions( void ) const;
+            uint64_t overflow( void )   const;
+            
+            /*
+             * Hottest blocks, by samples, then by executions.
+             */
+            std::vector< HotSpot > top( size_t count ) const;
+            
+            /*
+             * Writes the hottest blocks, with their disassembly.
+             */
+            void report( std::ostream & os, size_t count ) const;
+            
+        private:
+            
+            class IMPL;
+            std::unique_ptr< IMPL > impl;
+    };
+}
+
+#endif /* UB_PROFILER_HPP */
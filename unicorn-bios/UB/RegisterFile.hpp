@@ -0,0 +1,64 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#ifndef UB_REGISTER_FILE_HPP
+#define UB_REGISTER_FILE_HPP
+
+#include <cstdint>
+#include <type_traits>
+
+namespace UB
+{
+    /*
+     * Flat copy of the x86 real-mode register file, as read by
+     * Engine::snapshot().
+     * Only full registers are stored - 8 and 16 bits registers are derived
+     * by masking.
+     */
+    struct RegisterFile
+    {
+        uint32_t eax;
+        uint32_t ebx;
+        uint32_t ecx;
+        uint32_t edx;
+        uint32_t esi;
+        uint32_t edi;
+        uint32_t esp;
+        uint32_t ebp;
+        uint32_t eip;
+        uint32_t eflags;
+        uint16_t cs;
+        uint16_t ds;
+        uint16_t ss;
+        uint16_t es;
+        uint16_t fs;
+        uint16_t gs;
+    };
+    
+    static_assert( std::is_trivially_copyable< RegisterFile >::value, "RegisterFile must be trivially copyable" );
+    static_assert( std::is_standard_layout< RegisterFile >::value,    "RegisterFile must have a standard layout" );
+}
+
+#endif /* UB_REGISTER_FILE_HPP */
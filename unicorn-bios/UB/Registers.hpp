@@ -28,6 +28,8 @@
 #include <memory>
 #include <algorithm>
 #include <cstdint>
+#include <type_traits>
+#include "UB/RegisterFile.hpp"
 
 namespace UB
 {
@@ -39,11 +41,13 @@ namespace UB
             
             Registers( void );
             Registers( const Engine & engine );
-            Registers( const Registers & o );
-            Registers( Registers && o ) noexcept;
-            ~Registers( void );
+            Registers( const RegisterFile & file );
+            Registers( const Registers & o )                  = default;
+            Registers( Registers && o ) noexcept              = default;
+            ~Registers( void )                                = default;
             
-            Registers & operator =( Registers o );
+            Registers & operator =( const Registers & o )     = default;
+            Registers & operator =( Registers && o ) noexcept = default;
             
             bool cf( void ) const;
             
@@ -83,13 +87,21 @@ namespace UB
             uint32_t eip( void )    const;
             uint32_t eflags( void ) const;
             
+            const RegisterFile & file( void ) const;
+            
             friend void swap( Registers & o1, Registers & o2 );
             
         private:
             
-            class IMPL;
-            std::unique_ptr< IMPL > impl;
+            RegisterFile _file;
     };
+    
+    /*
+     * Registers are copied for every instruction, and may be stored in
+     * buffers, so they must stay small and cheap to copy.
+     */
+    static_assert( std::is_trivially_copyable< Registers >::value, "Registers must be trivially copyable" );
+    static_assert( sizeof( Registers ) <= 64,                      "Registers must fit in a cache line" );
 }
 
 #endif /* UB_REGISTERS_HPP */
@@ -23,6 +23,7 @@
  ******************************************************************************/
 
 #include "UB/Screen.hpp"
+#include "UB/Signal.hpp"
 #include <algorithm>
 #include <ncurses.h>
 #include <sys/ioctl.h>
@@ -33,6 +34,9 @@
 #include <poll.h>
 #include <condition_variable>
 #include <mutex>
+#include <atomic>
+#include <csignal>
+#include <fcntl.h>
 
 namespace UB
 {
@@ -43,15 +47,21 @@ namespace UB
             IMPL( void );
             ~IMPL( void );
             
+            void _wakeup( void );
+            
             std::vector< std::function< void( void ) > > _onResize;
             std::vector< std::function< void( int ) > >  _onKeyPress;
             std::vector< std::function< void( void ) > > _onUpdate;
             
-            std::size_t          _width;
-            std::size_t          _height;
-            bool                 _colors;
-            bool                 _running;
-            std::recursive_mutex _rmtx;
+            std::size_t                 _width;
+            std::size_t                 _height;
+            bool                        _colors;
+            std::atomic< bool >         _running;
+            std::atomic< bool >         _needsDisplay;
+            std::atomic< bool >         _continuousDisplay;
+            std::atomic< unsigned int > _fps;
+            int                         _pipe[ 2 ];
+            std::recursive_mutex        _rmtx;
     };
     
     Screen & Screen::shared( void )
@@ -99,6 +109,29 @@ namespace UB
         
         this->impl->_width  = s.ws_col;
         this->impl->_height = s.ws_row;
+        
+        /*
+         * Self-pipe, used to wake up the screen's loop from other threads,
+         * or when the terminal is resized.
+         */
+        if( pipe( this->impl->_pipe ) == 0 )
+        {
+            fcntl( this->impl->_pipe[ 0 ], F_SETFL, fcntl( this->impl->_pipe[ 0 ], F_GETFL ) | O_NONBLOCK );
+            fcntl( this->impl->_pipe[ 1 ], F_SETFL, fcntl( this->impl->_pipe[ 1 ], F_GETFL ) | O_NONBLOCK );
+            fcntl( this->impl->_pipe[ 0 ], F_SETFD, FD_CLOEXEC );
+            fcntl( this->impl->_pipe[ 1 ], F_SETFD, FD_CLOEXEC );
+            
+            Signal::handle
+            (
+                SIGWINCH,
+                [ this ]( int sig )
+                {
+                    ( void )sig;
+                    
+                    this->impl->_wakeup();
+                }
+            );
+        }
     }
     
     std::size_t Screen::width( void ) const
@@ -150,6 +183,13 @@ namespace UB
         ::refresh();
     }
     
+    void Screen::update( void ) const
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        
+        ::doupdate();
+    }
+    
     void Screen::print( const std::string & s )
     {
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
@@ -176,6 +216,8 @@ namespace UB
     
     void Screen::start( void )
     {
+        std::chrono::steady_clock::time_point last;
+        
         {
             std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
             
@@ -184,47 +226,82 @@ namespace UB
                 return;
             }
             
-            this->impl->_running = true;
+            this->impl->_running      = true;
+            this->impl->_needsDisplay = true;
         }
         
         while( this->impl->_running )
         {
             struct winsize                               s;
+            struct pollfd                                p[ 2 ];
             std::vector< std::function< void( void ) > > onResize;
             std::vector< std::function< void( int ) > >  onKeyPress;
             std::vector< std::function< void( void ) > > onUpdate;
-            int                                          key( 0 );
+            std::chrono::steady_clock::duration          frame( 0 );
+            int                                          delay( -1 );
+            unsigned char                                key( 0 );
             
-            ::ioctl( STDOUT_FILENO, TIOCGWINSZ, &s );
+            if( this->impl->_fps > 0 )
+            {
+                frame = std::chrono::duration_cast< std::chrono::steady_clock::duration >( std::chrono::seconds( 1 ) ) / this->impl->_fps.load();
+            }
             
+            /*
+             * Blocks until an event occurs, or until the next frame if a
+             * display update is pending, or if the display is continuous.
+             */
+            if( this->impl->_continuousDisplay && frame.count() > 0 && std::chrono::steady_clock::now() >= last + frame )
             {
-                std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
-                
-                onKeyPress = this->impl->_onKeyPress;
-                onUpdate   = this->impl->_onUpdate;
+                this->impl->_needsDisplay = true;
+            }
+            
+            if( this->impl->_needsDisplay || ( this->impl->_continuousDisplay && frame.count() > 0 ) )
+            {
+                auto wait( std::chrono::ceil< std::chrono::milliseconds >( ( last + frame ) - std::chrono::steady_clock::now() ) );
                 
-                if( s.ws_col != this->impl->_width || s.ws_row != this->impl->_height )
+                delay = static_cast< int >( std::max< std::chrono::milliseconds::rep >( wait.count(), 0 ) );
+            }
+            
+            memset( p, 0, sizeof( p ) );
+            
+            p[ 0 ].fd     = STDIN_FILENO;
+            p[ 0 ].events = POLLIN;
+            p[ 1 ].fd     = this->impl->_pipe[ 0 ];
+            p[ 1 ].events = POLLIN;
+            
+            if( poll( p, 2, delay ) > 0 )
+            {
+                if( p[ 1 ].revents & POLLIN )
                 {
-                    this->impl->_width  = s.ws_col;
-                    this->impl->_height = s.ws_row;
+                    char c[ 64 ];
                     
-                    onResize = this->impl->_onResize;
+                    while( read( this->impl->_pipe[ 0 ], c, sizeof( c ) ) > 0 )
+                    {}
                 }
                 
+                if( ( p[ 0 ].revents & POLLIN ) && read( STDIN_FILENO, &key, 1 ) == 1 )
                 {
-                    static struct pollfd p;
+                    std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
                     
-                    memset( &p, 0, sizeof( p ) );
+                    onKeyPress                = this->impl->_onKeyPress;
+                    this->impl->_needsDisplay = true;
+                }
+            }
+            
+            ::ioctl( STDOUT_FILENO, TIOCGWINSZ, &s );
+            
+            {
+                std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+                
+                if( s.ws_col != this->impl->_width || s.ws_row != this->impl->_height )
+                {
+                    this->impl->_width        = s.ws_col;
+                    this->impl->_height       = s.ws_row;
+                    this->impl->_needsDisplay = true;
                     
-                    p.fd      = 0;
-                    p.events  = POLLIN;
-                    p.revents = 0;
+                    ::resizeterm( s.ws_row, s.ws_col );
                     
-                    if( poll( &p, 1, 0 ) > 0 )
-                    {
-                        key        = getc( stdin );
-                        onKeyPress = this->impl->_onKeyPress;
-                    }
+                    onResize = this->impl->_onResize;
                 }
             }
             
@@ -238,12 +315,26 @@ namespace UB
                 f( key );
             }
             
+            if( this->impl->_running == false || this->impl->_needsDisplay == false || std::chrono::steady_clock::now() < last + frame )
+            {
+                continue;
+            }
+            
+            {
+                std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+                
+                onUpdate = this->impl->_onUpdate;
+            }
+            
+            this->impl->_needsDisplay = false;
+            last                      = std::chrono::steady_clock::now();
+            
             for( const auto & f: onUpdate )
             {
                 f();
             }
             
-            this->refresh();
+            this->update();
         }
         
         this->clear();
@@ -252,9 +343,36 @@ namespace UB
     
     void Screen::stop( void )
     {
-        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
-        
         this->impl->_running = false;
+        
+        this->impl->_wakeup();
+    }
+    
+    void Screen::setNeedsDisplay( void )
+    {
+        if( this->impl->_needsDisplay.exchange( true ) == false )
+        {
+            this->impl->_wakeup();
+        }
+    }
+    
+    void Screen::continuousDisplay( bool value )
+    {
+        this->impl->_continuousDisplay = value;
+        
+        this->impl->_wakeup();
+    }
+    
+    unsigned int Screen::fps( void ) const
+    {
+        return this->impl->_fps;
+    }
+    
+    void Screen::fps( unsigned int value )
+    {
+        this->impl->_fps = value;
+        
+        this->impl->_wakeup();
     }
     
     void Screen::onResize( const std::function< void( void ) > & f )
@@ -279,10 +397,14 @@ namespace UB
     }
     
     Screen::IMPL::IMPL( void ):
-        _width( 0 ),
-        _height( 0 ),
-        _colors( false ),
-        _running( false )
+        _width(             0 ),
+        _height(            0 ),
+        _colors(            false ),
+        _running(           false ),
+        _needsDisplay(      false ),
+        _continuousDisplay( false ),
+        _fps(               30 ),
+        _pipe{              -1, -1 }
     {}
     
     Screen::IMPL::~IMPL( void )
@@ -291,4 +413,14 @@ namespace UB
         ::refresh();
         ::endwin();
     }
+    
+    void Screen::IMPL::_wakeup( void )
+    {
+        char c( 0 );
+        
+        if( this->_pipe[ 1 ] != -1 )
+        {
+            ( void )write( this->_pipe[ 1 ], &c, 1 );
+        }
+    }
 }
@@ -50,6 +50,7 @@ namespace UB
             bool isRunning( void )      const;
             void clear( void )          const;
             void refresh( void )        const;
+            void update( void )         const;
             
             void print( const std::string & s );
             void print( const Color & color, const std::string & s );
@@ -57,6 +58,19 @@ namespace UB
             void start( void );
             void stop( void );
             
+            /*
+             * Screen updates are only performed when needed, after a key
+             * press, a resize, or an explicit request, and are limited to
+             * the given number of frames per second (0 means no limit).
+             * While continuous display is enabled, the screen is also
+             * updated at that rate, unless there's no limit.
+             * Can be called from any thread.
+             */
+            void         setNeedsDisplay( void );
+            unsigned int fps( void ) const;
+            void         fps( unsigned int value );
+            void         continuousDisplay( bool value );
+            
             void onResize( const std::function<   void( void ) > & f );
             void onKeyPress( const std::function< void( int key ) > & f );
             void onUpdate( const std::function<   void( void ) > & f );
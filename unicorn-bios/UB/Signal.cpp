@@ -26,11 +26,21 @@
 #include <mutex>
 #include <map>
 #include <vector>
+#include <thread>
+#include <string>
+#include <stdexcept>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
 
 static std::recursive_mutex                                          * rmtx;
 static std::map< int,  std::vector< std::function< void( int ) > > > * handlers;
+static int                                                             fds[ 2 ] = { -1, -1 };
 
 static void handle( int sig );
+static void dispatch( void );
 
 namespace UB
 {
@@ -47,15 +57,46 @@ namespace UB
                 {
                     rmtx     = new std::recursive_mutex();
                     handlers = new std::map< int, std::vector< std::function< void( int ) > > >();
+                    
+                    /*
+                     * Signal handlers only write the signal number to a
+                     * pipe. Handlers are called from a dedicated thread,
+                     * as locking or calling arbitrary code from a signal
+                     * handler isn't safe.
+                     */
+                    if( pipe( fds ) != 0 )
+                    {
+                        throw std::runtime_error( "Cannot create signal pipe" );
+                    }
+                    
+                    fcntl( fds[ 1 ], F_SETFL, fcntl( fds[ 1 ], F_GETFL ) | O_NONBLOCK );
+                    fcntl( fds[ 0 ], F_SETFD, FD_CLOEXEC );
+                    fcntl( fds[ 1 ], F_SETFD, FD_CLOEXEC );
+                    
+                    std::thread( dispatch ).detach();
                 }
             );
             
             {
                 std::lock_guard< std::recursive_mutex > l( *( rmtx ) );
                 
-                handlers->operator[]( sig ).push_back( handler );
+                if( handlers->operator[]( sig ).size() == 0 )
+                {
+                    struct sigaction action;
+                    
+                    memset( &action, 0, sizeof( action ) );
+                    sigemptyset( &( action.sa_mask ) );
+                    
+                    action.sa_handler = ::handle;
+                    action.sa_flags   = SA_RESTART;
+                    
+                    if( sigaction( sig, &action, nullptr ) != 0 )
+                    {
+                        throw std::runtime_error( "Cannot handle signal " + std::to_string( sig ) );
+                    }
+                }
                 
-                signal( SIGINT, ::handle ); 
+                handlers->operator[]( sig ).push_back( handler );
             }
         }
     }
@@ -63,10 +104,45 @@ namespace UB
 
 static void handle( int sig )
 {
-    std::lock_guard< std::recursive_mutex > l( *( rmtx ) );
+    int           e( errno );
+    unsigned char c( static_cast< unsigned char >( sig ) );
+    
+    ( void )write( fds[ 1 ], &c, 1 );
     
-    for( const auto & f: handlers->operator[]( sig ) )
+    errno = e;
+}
+
+static void dispatch( void )
+{
+    while( true )
     {
-        f( sig );
+        unsigned char                               c;
+        ssize_t                                     n( read( fds[ 0 ], &c, 1 ) );
+        std::vector< std::function< void( int ) > > functions;
+        
+        if( n < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        
+        if( n != 1 )
+        {
+            return;
+        }
+        
+        {
+            std::lock_guard< std::recursive_mutex > l( *( rmtx ) );
+            
+            functions = handlers->operator[]( c );
+        }
+        
+        /*
+         * Handlers are called without holding the lock, so they can
+         * register other handlers or wait for other threads.
+         */
+        for( const auto & f: functions )
+        {
+            f( c );
+        }
     }
 }
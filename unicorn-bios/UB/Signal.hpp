@@ -31,6 +31,12 @@ namespace UB
 {
     namespace Signal
     {
+        /*
+         * Registers a handler for a signal.
+         * Handlers are not called from the signal handler itself, but from
+         * a dedicated dispatcher thread, so they may safely lock or call
+         * into the UI and the engine.
+         */
         void handle( int sig, const std::function< void( int ) > & handler );
     }
 }
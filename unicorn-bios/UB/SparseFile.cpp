@@ -0,0 +1,404 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "UB/SparseFile.hpp"
+#include "UB/MappedFile.hpp"
+#include "UB/BinaryDataStream.hpp"
+#include "UB/Casts.hpp"
+#include "UB/Bytes.hpp"
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstring>
+#include <stdexcept>
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static constexpr const char * SparseFileMagic   = "UBSPARSE";
+static constexpr uint32_t     SparseFileVersion = 1;
+static constexpr size_t       HeaderSize        = 32;
+static constexpr size_t       IndexEntrySize    = 16;
+
+namespace UB
+{
+    class SparseFile::IMPL
+    {
+        public:
+            
+            enum class Type: uint32_t
+            {
+                Zero       = 0,
+                Raw        = 1,
+                Compressed = 2
+            };
+            
+            class Entry
+            {
+                public:
+                    
+                    uint64_t offset;
+                    uint32_t length;
+                    Type     type;
+            };
+            
+            class Block
+            {
+                public:
+                    
+                    uint64_t               index;
+                    std::vector< uint8_t > data;
+            };
+            
+            IMPL( const std::string & path, size_t cacheSize );
+            ~IMPL( void );
+            
+            const uint8_t * _block( uint64_t index );
+            
+            std::string                                                   _path;
+            int                                                           _fd;
+            size_t                                                        _size;
+            size_t                                                        _capacity;
+            std::vector< Entry >                                          _entries;
+            std::vector< uint8_t >                                        _zero;
+            std::vector< uint8_t >                                        _buffer;
+            std::list< Block >                                            _blocks;
+            std::unordered_map< uint64_t, std::list< Block >::iterator > _index;
+            std::mutex                                                    _mtx;
+    };
+    
+    bool SparseFile::isSparseFile( const std::string & path )
+    {
+        char magic[ 8 ];
+        int  fd;
+        bool sparse;
+        
+        if( ( fd = open( path.c_str(), O_RDONLY ) ) == -1 )
+        {
+            return false;
+        }
+        
+        sparse = pread( fd, magic, sizeof( magic ), 0 ) == sizeof( magic ) && memcmp( magic, SparseFileMagic, sizeof( magic ) ) == 0;
+        
+        close( fd );
+        
+        return sparse;
+    }
+    
+    void SparseFile::create( const std::string & image, const std::string & path )
+    {
+        MappedFile             file( image );
+        uint64_t               blocks( ( file.size() + BlockSize - 1 ) / BlockSize );
+        uint64_t               offset( HeaderSize + blocks * IndexEntrySize );
+        std::vector< uint8_t > header;
+        std::vector< uint8_t > index;
+        std::vector< uint8_t > compressed( compressBound( BlockSize ) );
+        int                    fd;
+        
+        if( ( fd = open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 ) ) == -1 )
+        {
+            throw std::runtime_error( "Cannot create file: " + path );
+        }
+        
+        try
+        {
+            for( uint64_t i = 0; i < blocks; i++ )
+            {
+                const uint8_t * data( file.data() + i * BlockSize );
+                size_t          length( std::min( BlockSize, numeric_cast< size_t >( file.size() - i * BlockSize ) ) );
+                uLongf          compressedLength( numeric_cast< uLongf >( compressed.size() ) );
+                IMPL::Type      type( IMPL::Type::Zero );
+                const uint8_t * stored( nullptr );
+                size_t          storedLength( 0 );
+                
+                if( std::any_of( data, data + length, []( uint8_t c ) { return c != 0; } ) == false )
+                {
+                    type = IMPL::Type::Zero;
+                }
+                else if( compress2( compressed.data(), &compressedLength, data, numeric_cast< uLong >( length ), Z_BEST_COMPRESSION ) == Z_OK && compressedLength < length )
+                {
+                    type         = IMPL::Type::Compressed;
+                    stored       = compressed.data();
+                    storedLength = numeric_cast< size_t >( compressedLength );
+                }
+                else
+                {
+                    type         = IMPL::Type::Raw;
+                    stored       = data;
+                    storedLength = length;
+                }
+                
+                Bytes::appendLittleEndian( index, ( stored != nullptr ) ? offset : 0, 8 );
+                Bytes::appendLittleEndian( index, storedLength,                       4 );
+                Bytes::appendLittleEndian( index, static_cast< uint32_t >( type ),    4 );
+                
+                if( stored != nullptr )
+                {
+                    if( pwrite( fd, stored, storedLength, numeric_cast< off_t >( offset ) ) != numeric_cast< ssize_t >( storedLength ) )
+                    {
+                        throw std::runtime_error( "Cannot write file: " + path );
+                    }
+                    
+                    offset += storedLength;
+                }
+            }
+            
+            header.insert( header.end(), SparseFileMagic, SparseFileMagic + 8 );
+            Bytes::appendLittleEndian( header, SparseFileVersion, 4 );
+            Bytes::appendLittleEndian( header, BlockSize,         4 );
+            Bytes::appendLittleEndian( header, file.size(),       8 );
+            Bytes::appendLittleEndian( header, blocks,            8 );
+            
+            header.insert( header.end(), index.begin(), index.end() );
+            
+            if( pwrite( fd, header.data(), header.size(), 0 ) != numeric_cast< ssize_t >( header.size() ) )
+            {
+                throw std::runtime_error( "Cannot write file: " + path );
+            }
+        }
+        catch( ... )
+        {
+            close( fd );
+            
+            throw;
+        }
+        
+        close( fd );
+    }
+    
+    SparseFile::SparseFile( const std::string & path, size_t cacheSize ):
+        impl( std::make_unique< IMPL >( path, cacheSize ) )
+    {}
+    
+    SparseFile::~SparseFile( void )
+    {}
+    
+    std::string SparseFile::path( void ) const
+    {
+        return this->impl->_path;
+    }
+    
+    size_t SparseFile::size( void ) const
+    {
+        return this->impl->_size;
+    }
+    
+    void SparseFile::read( uint64_t offset, size_t size, const std::function< void( uint64_t, const uint8_t *, size_t ) > & handler ) const
+    {
+        std::lock_guard< std::mutex > l( this->impl->_mtx );
+        uint64_t                      position( 0 );
+        
+        if( offset > this->impl->_size || size > this->impl->_size - offset )
+        {
+            throw std::runtime_error( "Invalid read - Not enough data available" );
+        }
+        
+        while( position < size )
+        {
+            uint64_t index( ( offset + position ) / BlockSize );
+            uint64_t start( ( offset + position ) % BlockSize );
+            size_t   length( numeric_cast< size_t >( std::min< uint64_t >( BlockSize - start, size - position ) ) );
+            
+            handler( position, this->impl->_block( index ) + start, length );
+            
+            position += length;
+        }
+    }
+    
+    SparseFile::IMPL::IMPL( const std::string & path, size_t cacheSize ):
+        _path(     path ),
+        _fd(       -1 ),
+        _size(     0 ),
+        _capacity( std::max< size_t >( cacheSize / BlockSize, 1 ) ),
+        _zero(     BlockSize, 0 )
+    {
+        if( ( this->_fd = open( path.c_str(), O_RDONLY ) ) == -1 )
+        {
+            throw std::runtime_error( "Cannot open file: " + path );
+        }
+        
+        try
+        {
+            std::vector< uint8_t > header( HeaderSize );
+            uint64_t               blocks;
+            uint64_t               fileSize;
+            struct stat            st;
+            
+            if( fstat( this->_fd, &st ) != 0 )
+            {
+                throw std::runtime_error( "Cannot read file: " + path );
+            }
+            
+            fileSize = static_cast< uint64_t >( st.st_size );
+            
+            Bytes::readAll( this->_fd, header.data(), header.size(), 0, path );
+            
+            {
+                BinaryDataStream stream( header );
+                
+                if( stream.ReadString( 8 ) != SparseFileMagic || stream.ReadLittleEndianUInt32() != SparseFileVersion || stream.ReadLittleEndianUInt32() != BlockSize )
+                {
+                    throw std::runtime_error( "Unsupported sparse file: " + path );
+                }
+                
+                this->_size = numeric_cast< size_t >( stream.ReadLittleEndianUInt64() );
+                blocks      = stream.ReadLittleEndianUInt64();
+            }
+            
+            if( blocks != ( this->_size + BlockSize - 1 ) / BlockSize || blocks > ( fileSize - HeaderSize ) / IndexEntrySize )
+            {
+                throw std::runtime_error( "Invalid sparse file index: " + path );
+            }
+            
+            {
+                std::vector< uint8_t > index( numeric_cast< size_t >( blocks * IndexEntrySize ) );
+                
+                Bytes::readAll( this->_fd, index.data(), index.size(), HeaderSize, path );
+                
+                {
+                    BinaryDataStream stream( index );
+                    
+                    for( uint64_t i = 0; i < blocks; i++ )
+                    {
+                        Entry entry;
+                        
+                        entry.offset = stream.ReadLittleEndianUInt64();
+                        entry.length = stream.ReadLittleEndianUInt32();
+                        entry.type   = static_cast< Type >( stream.ReadLittleEndianUInt32() );
+                        
+                        /*
+                         * Entries are checked once here, so reading a block
+                         * never allocates or reads more than the file holds.
+                         */
+                        if( entry.type != Type::Zero && entry.type != Type::Raw && entry.type != Type::Compressed )
+                        {
+                            throw std::runtime_error( "Invalid block type in sparse file: " + path );
+                        }
+                        
+                        if( entry.type != Type::Zero && ( entry.length > compressBound( BlockSize ) || entry.offset > fileSize || entry.length > fileSize - entry.offset ) )
+                        {
+                            throw std::runtime_error( "Invalid block in sparse file: " + path );
+                        }
+                        
+                        this->_entries.push_back( entry );
+                    }
+                }
+            }
+        }
+        catch( ... )
+        {
+            close( this->_fd );
+            
+            throw;
+        }
+    }
+    
+    SparseFile::IMPL::~IMPL( void )
+    {
+        if( this->_fd != -1 )
+        {
+            close( this->_fd );
+        }
+    }
+    
+    const uint8_t * SparseFile::IMPL::_block( uint64_t index )
+    {
+        const Entry & entry( this->_entries[ index ] );
+        size_t        length( std::min( BlockSize, numeric_cast< size_t >( this->_size - index * BlockSize ) ) );
+        
+        /*
+         * Zero blocks are never cached, as they all share the same data.
+         */
+        if( entry.type == Type::Zero )
+        {
+            return this->_zero.data();
+        }
+        
+        {
+            auto it( this->_index.find( index ) );
+            
+            if( it != this->_index.end() )
+            {
+                this->_blocks.splice( this->_blocks.begin(), this->_blocks, it->second );
+                
+                return it->second->data.data();
+            }
+        }
+        
+        if( this->_blocks.size() >= this->_capacity )
+        {
+            this->_index.erase( this->_blocks.back().index );
+            this->_blocks.splice( this->_blocks.begin(), this->_blocks, std::prev( this->_blocks.end() ) );
+        }
+        else
+        {
+            this->_blocks.emplace_front();
+        }
+        
+        {
+            Block & block( this->_blocks.front() );
+            
+            block.index = index;
+            
+            block.data.resize( length );
+            
+            try
+            {
+                if( entry.type == Type::Raw && entry.length == length )
+                {
+                    Bytes::readAll( this->_fd, block.data.data(), length, entry.offset, this->_path );
+                }
+                else if( entry.type == Type::Compressed )
+                {
+                    uLongf decompressed( numeric_cast< uLongf >( length ) );
+                    
+                    this->_buffer.resize( entry.length );
+                    
+                    Bytes::readAll( this->_fd, this->_buffer.data(), this->_buffer.size(), entry.offset, this->_path );
+                    
+                    if( uncompress( block.data.data(), &decompressed, this->_buffer.data(), numeric_cast< uLong >( this->_buffer.size() ) ) != Z_OK || decompressed != length )
+                    {
+                        throw std::runtime_error( "Invalid compressed block in sparse file: " + this->_path );
+                    }
+                }
+                else
+                {
+                    throw std::runtime_error( "Invalid block in sparse file: " + this->_path );
+                }
+            }
+            catch( ... )
+            {
+                this->_blocks.pop_front();
+                
+                throw;
+            }
+            
+            this->_index[ index ] = this->_blocks.begin();
+            
+            return block.data.data();
+        }
+    }
+}
@@ -0,0 +1,87 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#ifndef UB_SPARSE_FILE_HPP
+#define UB_SPARSE_FILE_HPP
+
+#include <memory>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+#include "UB/FileStorage.hpp"
+
+namespace UB
+{
+    /*
+     * Sparse container for disk images.
+     * 
+     * The file starts with a header, followed by an index of blocks and
+     * the blocks' data. Blocks are compressed with zlib, or stored as-is
+     * if they don't compress, while blocks only containing zeros are not
+     * stored at all.
+     * All values are little endian.
+     * 
+     *     Header:      Magic       8 bytes     "UBSPARSE"
+     *                  Version     4 bytes     1
+     *                  Block size  4 bytes
+     *                  Size        8 bytes     Size of the raw image
+     *                  Blocks      8 bytes     Number of index entries
+     *     
+     *     Index entry: Offset      8 bytes     Offset of the block's data
+     *                  Length      4 bytes     Length of the block's data
+     *                  Type        4 bytes     Zero, Raw or Compressed
+     * 
+     * Decompressed blocks are kept in a bounded LRU cache.
+     */
+    class SparseFile: public FileStorage
+    {
+        public:
+            
+            static constexpr size_t BlockSize = 64 * 1024;
+            
+            static bool isSparseFile( const std::string & path );
+            static void create( const std::string & image, const std::string & path );
+            
+            SparseFile( const std::string & path, size_t cacheSize );
+            ~SparseFile( void ) override;
+            
+            SparseFile( const SparseFile & o )              = delete;
+            SparseFile( SparseFile && o )                   = delete;
+            SparseFile & operator =( const SparseFile & o ) = delete;
+            SparseFile & operator =( SparseFile && o )      = delete;
+            
+            std::string path( void ) const override;
+            size_t      size( void ) const override;
+            
+            void read( uint64_t offset, size_t size, const std::function< void( uint64_t, const uint8_t *, size_t ) > & handler ) const override;
+            
+        private:
+            
+            class IMPL;
+            std::unique_ptr< IMPL > impl;
+    };
+}
+
+#endif /* UB_SPARSE_FILE_HPP */
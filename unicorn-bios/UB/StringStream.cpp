@@ -27,6 +27,8 @@
 #include <sstream>
 #include <vector>
 #include <functional>
+#include <fstream>
+#include <stdexcept>
 
 namespace UB
 {
@@ -40,9 +42,22 @@ namespace UB
             IMPL( const IMPL & o, const std::lock_guard< std::recursive_mutex > & l );
             ~IMPL( void );
             
+            static constexpr size_t DefaultMaximumLines = 10000;
+            
+            void _flush( void );
+            void _append( const std::string & s );
+            void _spillLines( size_t count );
+            void _normalize( void );
+            
             mutable std::recursive_mutex                          _rmtx;
             std::stringstream                                     _ss;
             std::vector< std::reference_wrapper< std::ostream > > _redirects;
+            std::vector< std::string >                            _lines;
+            size_t                                                _first;
+            std::string                                           _current;
+            size_t                                                _maximumLines;
+            std::unique_ptr< std::ofstream >                      _spill;
+            uint64_t                                              _version;
     };
 
     StringStream::StringStream( void ):
@@ -77,12 +92,110 @@ namespace UB
     }
 
     std::string StringStream::string( void ) const
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        std::string                             s;
+        
+        for( size_t i = 0; i < this->impl->_lines.size(); i++ )
+        {
+            s += this->impl->_lines[ ( this->impl->_first + i ) % this->impl->_lines.size() ];
+            s += '\n';
+        }
+        
+        return s + this->impl->_current;
+    }
+    
+    size_t StringStream::maximumLines( void ) const
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        
+        return this->impl->_maximumLines;
+    }
+    
+    void StringStream::maximumLines( size_t value )
     {
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
-        return this->impl->_ss.str();
+        this->impl->_maximumLines = value;
+        
+        this->impl->_normalize();
+        
+        if( value > 0 && this->impl->_lines.size() > value )
+        {
+            size_t count( this->impl->_lines.size() - value );
+            
+            this->impl->_spillLines( count );
+            this->impl->_lines.erase( this->impl->_lines.begin(), this->impl->_lines.begin() + static_cast< ssize_t >( count ) );
+        }
     }
+    
+    void StringStream::spill( const std::string & path )
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        
+        this->impl->_spill = std::make_unique< std::ofstream >( path, std::ios::out | std::ios::app );
+        
+        if( this->impl->_spill->good() == false )
+        {
+            this->impl->_spill = nullptr;
             
+            throw std::runtime_error( "Cannot open file " + path );
+        }
+    }
+    
+    std::vector< std::string > StringStream::lines( size_t count ) const
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        std::vector< std::string >              lines;
+        size_t                                  size( this->impl->_lines.size() );
+        
+        if( count == 0 )
+        {
+            return lines;
+        }
+        
+        if( this->impl->_current.length() > 0 )
+        {
+            count--;
+        }
+        
+        count = std::min( count, size );
+        
+        lines.reserve( count + 1 );
+        
+        for( size_t i = size - count; i < size; i++ )
+        {
+            lines.push_back( this->impl->_lines[ ( this->impl->_first + i ) % size ] );
+        }
+        
+        if( this->impl->_current.length() > 0 )
+        {
+            lines.push_back( this->impl->_current );
+        }
+        
+        return lines;
+    }
+    
+    uint64_t StringStream::version( void ) const
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        
+        return this->impl->_version;
+    }
+    
+    void StringStream::clear( void )
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        
+        this->impl->_ss.str( "" );
+        this->impl->_lines.clear();
+        this->impl->_current.clear();
+        
+        this->impl->_first = 0;
+        
+        this->impl->_version++;
+    }
+    
     void StringStream::redirect( std::ostream & os )
     {
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
@@ -94,7 +207,7 @@ namespace UB
     {
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
-        this->impl->_ss << s;
+        this->impl->_append( s );
         
         for( const auto & os: this->impl->_redirects )
         {
@@ -109,6 +222,7 @@ namespace UB
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
         this->impl->_ss << v;
+        this->impl->_flush();
         
         for( const auto & os: this->impl->_redirects )
         {
@@ -123,6 +237,7 @@ namespace UB
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
         this->impl->_ss << v;
+        this->impl->_flush();
         
         for( const auto & os: this->impl->_redirects )
         {
@@ -137,6 +252,7 @@ namespace UB
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
         this->impl->_ss << v;
+        this->impl->_flush();
         
         for( const auto & os: this->impl->_redirects )
         {
@@ -151,6 +267,7 @@ namespace UB
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
         this->impl->_ss << v;
+        this->impl->_flush();
         
         for( const auto & os: this->impl->_redirects )
         {
@@ -165,6 +282,7 @@ namespace UB
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
         this->impl->_ss << v;
+        this->impl->_flush();
         
         for( const auto & os: this->impl->_redirects )
         {
@@ -179,6 +297,7 @@ namespace UB
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
         this->impl->_ss << v;
+        this->impl->_flush();
         
         for( const auto & os: this->impl->_redirects )
         {
@@ -193,6 +312,7 @@ namespace UB
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
         this->impl->_ss << v;
+        this->impl->_flush();
         
         for( const auto & os: this->impl->_redirects )
         {
@@ -207,6 +327,7 @@ namespace UB
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
         this->impl->_ss << v;
+        this->impl->_flush();
         
         for( const auto & os: this->impl->_redirects )
         {
@@ -221,6 +342,7 @@ namespace UB
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
         this->impl->_ss << v;
+        this->impl->_flush();
         
         for( const auto & os: this->impl->_redirects )
         {
@@ -235,6 +357,7 @@ namespace UB
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
         this->impl->_ss << v;
+        this->impl->_flush();
         
         for( const auto & os: this->impl->_redirects )
         {
@@ -249,6 +372,7 @@ namespace UB
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
         this->impl->_ss << v;
+        this->impl->_flush();
         
         for( const auto & os: this->impl->_redirects )
         {
@@ -263,6 +387,7 @@ namespace UB
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
         f( this->impl->_ss );
+        this->impl->_flush();
         
         for( const auto & os: this->impl->_redirects )
         {
@@ -277,6 +402,7 @@ namespace UB
         std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
         
         f( this->impl->_ss );
+        this->impl->_flush();
         
         for( const auto & os: this->impl->_redirects )
         {
@@ -293,23 +419,118 @@ namespace UB
         swap( o1.impl, o2.impl );
     }
 
-    StringStream::IMPL::IMPL()
+    StringStream::IMPL::IMPL():
+        _first(        0 ),
+        _maximumLines( DefaultMaximumLines ),
+        _version(      0 )
     {}
 
     StringStream::IMPL::IMPL( const std::string & s ):
-        _ss( s )
-    {}
+        IMPL()
+    {
+        this->_append( s );
+    }
 
     StringStream::IMPL::IMPL( const IMPL & o ):
         IMPL( o, std::lock_guard< std::recursive_mutex >( o._rmtx ) )
     {}
 
     StringStream::IMPL::IMPL( const IMPL & o, const std::lock_guard< std::recursive_mutex > & l ):
-        _ss( o._ss.str() )
+        _lines(        o._lines ),
+        _first(        o._first ),
+        _current(      o._current ),
+        _maximumLines( o._maximumLines ),
+        _version(      o._version )
     {
         ( void )l;
     }
 
     StringStream::IMPL::~IMPL( void )
     {}
+    
+    /*
+     * Moves formatted values from the stream to the lines buffer.
+     */
+    void StringStream::IMPL::_flush( void )
+    {
+        std::string s( this->_ss.str() );
+        
+        if( s.length() > 0 )
+        {
+            this->_ss.str( "" );
+            this->_append( s );
+        }
+    }
+    
+    void StringStream::IMPL::_append( const std::string & s )
+    {
+        size_t begin( 0 );
+        
+        this->_version++;
+        
+        while( begin < s.length() )
+        {
+            size_t end( s.find( '\n', begin ) );
+            
+            if( end == std::string::npos )
+            {
+                this->_current.append( s, begin, std::string::npos );
+                
+                break;
+            }
+            
+            this->_current.append( s, begin, end - begin );
+            
+            begin = end + 1;
+            
+            if( this->_maximumLines == 0 || this->_lines.size() < this->_maximumLines )
+            {
+                this->_normalize();
+                this->_lines.push_back( std::move( this->_current ) );
+            }
+            else
+            {
+                /*
+                 * Buffer is full - the oldest line is replaced.
+                 */
+                this->_spillLines( 1 );
+                
+                std::swap( this->_lines[ this->_first ], this->_current );
+                
+                this->_first = ( this->_first + 1 ) % this->_lines.size();
+            }
+            
+            this->_current.clear();
+        }
+    }
+    
+    /*
+     * Writes the oldest lines to the spill file, if any, before they are
+     * evicted.
+     */
+    void StringStream::IMPL::_spillLines( size_t count )
+    {
+        if( this->_spill == nullptr )
+        {
+            return;
+        }
+        
+        for( size_t i = 0; i < count && i < this->_lines.size(); i++ )
+        {
+            *( this->_spill ) << this->_lines[ ( this->_first + i ) % this->_lines.size() ] << '\n';
+        }
+    }
+    
+    /*
+     * Rotates the buffer, so the oldest line is at index 0.
+     */
+    void StringStream::IMPL::_normalize( void )
+    {
+        if( this->_first != 0 )
+        {
+            std::rotate( this->_lines.begin(), this->_lines.begin() + static_cast< ssize_t >( this->_first ), this->_lines.end() );
+            
+            this->_first = 0;
+        }
+    }
 }
@@ -31,6 +31,8 @@
 #include <string>
 #include <ios>
 #include <ostream>
+#include <vector>
+#include <cstdint>
 
 namespace UB
 {
@@ -49,6 +51,26 @@ namespace UB
             operator std::string()     const;
             std::string string( void ) const;
             
+            /*
+             * Only the last lines are retained (0 for no limit).
+             * Evicted lines are lost, unless a spill file is set, in which
+             * case they are appended to it.
+             */
+            size_t maximumLines( void ) const;
+            void   maximumLines( size_t value );
+            void   spill( const std::string & path );
+            
+            /*
+             * Last lines, including the current unterminated line, if any.
+             */
+            std::vector< std::string > lines( size_t count ) const;
+            
+            /*
+             * Incremented each time the stream is written to.
+             */
+            uint64_t version( void ) const;
+            
+            void clear( void );
             void redirect( std::ostream & os );
             
             StringStream & operator <<( const std::string & s );
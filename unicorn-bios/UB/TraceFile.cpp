@@ -0,0 +1,732 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "UB/TraceFile.hpp"
+#include "UB/BinaryDataStream.hpp"
+#include "UB/Casts.hpp"
+#include "UB/Bytes.hpp"
+#include <array>
+#include <unordered_map>
+#include <limits>
+#include <cstring>
+#include <stdexcept>
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static constexpr const char * TraceFileMagic    = "UBTRACE";
+static constexpr const char * TraceIndexMagic   = "UBTRIDX";
+static constexpr uint32_t     TraceFileVersion  = 3;
+static constexpr size_t       HeaderSize        = 16;
+static constexpr size_t       ColumnCount       = 4;
+static constexpr size_t       IndexEntrySize    = 36 + ColumnCount * 16;
+static constexpr size_t       FooterSize        = 24;
+static constexpr size_t       RegisterFileSize  = 10 * 4 + 6 * 2;
+static constexpr size_t       WriteSize         = 4 + 4 + 1 + 8;
+static constexpr uint32_t     NotRecorded       = 0xFFFFFFFF;
+
+static void appendRegisters( std::vector< uint8_t > & data, const UB::RegisterFile & registers );
+
+namespace UB
+{
+    enum class Column: size_t
+    {
+        Code      = 0,
+        Steps     = 1,
+        Registers = 2,
+        Writes    = 3
+    };
+    
+    class ColumnEntry
+    {
+        public:
+            
+            uint64_t offset;
+            uint32_t length;
+            uint32_t raw;
+    };
+    
+    class TraceFile::Writer::IMPL
+    {
+        public:
+            
+            IMPL( const std::string & path, bool registers );
+            ~IMPL( void );
+            
+            void _flush( void );
+            void _write( const uint8_t * data, size_t size );
+            
+            std::string                                                  _path;
+            bool                                                         _registers;
+            int                                                          _fd;
+            uint64_t                                                     _offset;
+            uint64_t                                                     _instructions;
+            Chunk                                                        _chunk;
+            std::array< std::vector< uint8_t >, ColumnCount >            _columns;
+            std::unordered_map< uint32_t, std::vector< uint32_t > >      _code;
+            std::vector< uint8_t >                                       _compressed;
+            std::vector< uint8_t >                                       _index;
+            uint64_t                                                     _chunks;
+            bool                                                         _finished;
+    };
+    
+    class TraceFile::IMPL
+    {
+        public:
+            
+            IMPL( const std::string & path );
+            ~IMPL( void );
+            
+            std::optional< size_t > _find( uint64_t instruction )          const;
+            size_t                  _index( const Chunk & chunk )          const;
+            std::vector< uint8_t >  _column( size_t chunk, Column column ) const;
+            
+            std::string                                           _path;
+            int                                                   _fd;
+            bool                                                  _registers;
+            uint64_t                                              _instructions;
+            std::vector< Chunk >                                  _chunks;
+            std::vector< std::array< ColumnEntry, ColumnCount > > _columns;
+    };
+    
+    bool TraceFile::Instruction::recorded( void ) const
+    {
+        return this->bytes.size() > 0;
+    }
+    
+    bool TraceFile::Write::lost( void ) const
+    {
+        return this->size == 0;
+    }
+    
+    bool TraceFile::Chunk::contains( uint64_t instruction ) const
+    {
+        return instruction >= this->first && instruction - this->first < this->instructions;
+    }
+    
+    bool TraceFile::Chunk::executes( uint32_t begin, uint32_t end ) const
+    {
+        return this->codeBegin <= this->codeEnd && begin <= this->codeEnd && end >= this->codeBegin;
+    }
+    
+    bool TraceFile::Chunk::writesTo( uint32_t begin, uint32_t end ) const
+    {
+        return this->writeBegin <= this->writeEnd && begin <= this->writeEnd && end >= this->writeBegin;
+    }
+    
+    TraceFile::Writer::Writer( const std::string & path, bool registers ):
+        impl( std::make_unique< IMPL >( path, registers ) )
+    {}
+    
+    TraceFile::Writer::~Writer( void )
+    {}
+    
+    void TraceFile::Writer::instruction( uint32_t address, const uint8_t * bytes, size_t size, const RegisterFile & registers )
+    {
+        std::vector< uint8_t >  & code( this->impl->_columns[ static_cast< size_t >( Column::Code ) ] );
+        std::optional< uint32_t > index;
+        
+        /*
+         * Chunks are only written when the next instruction arrives, as
+         * memory writes follow the instruction they belong to.
+         */
+        if( this->impl->_chunk.instructions == ChunkSize )
+        {
+            this->impl->_flush();
+        }
+        
+        /*
+         * Instructions are stored once per chunk, unless their bytes change.
+         */
+        {
+            std::vector< uint32_t > & offsets( this->impl->_code[ address ] );
+            
+            for( auto offset: offsets )
+            {
+                if( code[ offset + 4 ] == size && memcmp( code.data() + offset + 5, bytes, size ) == 0 )
+                {
+                    index = offset;
+                    
+                    break;
+                }
+            }
+            
+            if( index.has_value() == false )
+            {
+                index = numeric_cast< uint32_t >( code.size() );
+                
+                offsets.push_back( index.value() );
+                Bytes::appendLittleEndian( code, address, 4 );
+                Bytes::appendLittleEndian( code, size,    1 );
+                code.insert( code.end(), bytes, bytes + size );
+            }
+        }
+        
+        Bytes::appendLittleEndian( this->impl->_columns[ static_cast< size_t >( Column::Steps ) ], index.value(), 4 );
+        
+        if( this->impl->_registers )
+        {
+            appendRegisters( this->impl->_columns[ static_cast< size_t >( Column::Registers ) ], registers );
+        }
+        
+        this->impl->_chunk.codeBegin = std::min( this->impl->_chunk.codeBegin, address );
+        this->impl->_chunk.codeEnd   = std::max( this->impl->_chunk.codeEnd,   numeric_cast< uint32_t >( address + size - 1 ) );
+        
+        this->impl->_chunk.instructions++;
+    }
+    
+    void TraceFile::Writer::lost( uint64_t count )
+    {
+        RegisterFile none;
+        
+        memset( &none, 0, sizeof( none ) );
+        
+        for( uint64_t i = 0; i < count; i++ )
+        {
+            if( this->impl->_chunk.instructions == ChunkSize )
+            {
+                this->impl->_flush();
+            }
+            
+            Bytes::appendLittleEndian( this->impl->_columns[ static_cast< size_t >( Column::Steps ) ], NotRecorded, 4 );
+            
+            if( this->impl->_registers )
+            {
+                appendRegisters( this->impl->_columns[ static_cast< size_t >( Column::Registers ) ], none );
+            }
+            
+            this->impl->_chunk.instructions++;
+        }
+    }
+    
+    /*
+     * Writes belong to the last recorded instruction.
+     */
+    void TraceFile::Writer::write( uint32_t address, uint8_t size, uint64_t value )
+    {
+        std::vector< uint8_t > & writes( this->impl->_columns[ static_cast< size_t >( Column::Writes ) ] );
+        uint32_t                 instruction( this->impl->_chunk.instructions );
+        
+        if( instruction == 0 )
+        {
+            return;
+        }
+        
+        Bytes::appendLittleEndian( writes, instruction - 1, 4 );
+        Bytes::appendLittleEndian( writes, address,         4 );
+        Bytes::appendLittleEndian( writes, size,            1 );
+        Bytes::appendLittleEndian( writes, value,           8 );
+        
+        this->impl->_chunk.writes++;
+        
+        this->impl->_chunk.writeBegin = std::min( this->impl->_chunk.writeBegin, address );
+        this->impl->_chunk.writeEnd   = std::max( this->impl->_chunk.writeEnd,   numeric_cast< uint32_t >( address + std::max< uint32_t >( size, 1 ) - 1 ) );
+    }
+    
+    /*
+     * Lost writes may have targeted any address, so they don't change the
+     * write range of the chunk.
+     */
+    void TraceFile::Writer::lostWrites( uint64_t count )
+    {
+        std::vector< uint8_t > & writes( this->impl->_columns[ static_cast< size_t >( Column::Writes ) ] );
+        uint32_t                 instruction( this->impl->_chunk.instructions );
+        
+        if( instruction == 0 || count == 0 )
+        {
+            return;
+        }
+        
+        count = std::min< uint64_t >( count, std::numeric_limits< uint32_t >::max() - this->impl->_chunk.lostWrites );
+        
+        Bytes::appendLittleEndian( writes, instruction - 1, 4 );
+        Bytes::appendLittleEndian( writes, 0,               4 );
+        Bytes::appendLittleEndian( writes, 0,               1 );
+        Bytes::appendLittleEndian( writes, count,           8 );
+        
+        this->impl->_chunk.writes++;
+        
+        this->impl->_chunk.lostWrites += static_cast< uint32_t >( count );
+    }
+    
+    void TraceFile::Writer::finish( void )
+    {
+        std::vector< uint8_t > footer;
+        
+        if( this->impl->_finished )
+        {
+            return;
+        }
+        
+        if( this->impl->_chunk.instructions > 0 )
+        {
+            this->impl->_flush();
+        }
+        
+        Bytes::appendLittleEndian( footer, this->impl->_offset, 8 );
+        Bytes::appendLittleEndian( footer, this->impl->_chunks, 8 );
+        footer.insert( footer.end(), TraceIndexMagic, TraceIndexMagic + 8 );
+        
+        this->impl->_write( this->impl->_index.data(), this->impl->_index.size() );
+        this->impl->_write( footer.data(),             footer.size() );
+        
+        this->impl->_finished = true;
+    }
+    
+    TraceFile::Writer::IMPL::IMPL( const std::string & path, bool registers ):
+        _path(         path ),
+        _registers(    registers ),
+        _fd(           -1 ),
+        _offset(       0 ),
+        _instructions( 0 ),
+        _chunk(        {} ),
+        _chunks(       0 ),
+        _finished(     false )
+    {
+        std::vector< uint8_t > header;
+        
+        this->_chunk.codeBegin  = std::numeric_limits< uint32_t >::max();
+        this->_chunk.writeBegin = std::numeric_limits< uint32_t >::max();
+        
+        if( ( this->_fd = open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 ) ) == -1 )
+        {
+            throw std::runtime_error( "Cannot create file: " + path );
+        }
+        
+        header.insert( header.end(), TraceFileMagic, TraceFileMagic + 8 );
+        Bytes::appendLittleEndian( header, TraceFileVersion,  4 );
+        Bytes::appendLittleEndian( header, registers ? 1 : 0, 4 );
+        
+        try
+        {
+            this->_write( header.data(), header.size() );
+        }
+        catch( ... )
+        {
+            close( this->_fd );
+            
+            throw;
+        }
+    }
+    
+    TraceFile::Writer::IMPL::~IMPL( void )
+    {
+        if( this->_fd != -1 )
+        {
+            close( this->_fd );
+        }
+    }
+    
+    void TraceFile::Writer::IMPL::_flush( void )
+    {
+        std::vector< uint8_t > entry;
+        
+        Bytes::appendLittleEndian( entry, this->_instructions,       8 );
+        Bytes::appendLittleEndian( entry, this->_chunk.instructions, 4 );
+        Bytes::appendLittleEndian( entry, this->_chunk.writes,       4 );
+        Bytes::appendLittleEndian( entry, this->_chunk.lostWrites,   4 );
+        Bytes::appendLittleEndian( entry, this->_chunk.codeBegin,    4 );
+        Bytes::appendLittleEndian( entry, this->_chunk.codeEnd,      4 );
+        Bytes::appendLittleEndian( entry, this->_chunk.writeBegin,   4 );
+        Bytes::appendLittleEndian( entry, this->_chunk.writeEnd,     4 );
+        
+        for( auto & column: this->_columns )
+        {
+            uLongf length( compressBound( numeric_cast< uLong >( column.size() ) ) );
+            
+            this->_compressed.resize( numeric_cast< size_t >( length ) );
+            
+            if( compress2( this->_compressed.data(), &length, column.data(), numeric_cast< uLong >( column.size() ), Z_DEFAULT_COMPRESSION ) != Z_OK )
+            {
+                throw std::runtime_error( "Cannot compress trace chunk: " + this->_path );
+            }
+            
+            Bytes::appendLittleEndian( entry, this->_offset, 8 );
+            Bytes::appendLittleEndian( entry, length,        4 );
+            Bytes::appendLittleEndian( entry, column.size(), 4 );
+            
+            this->_write( this->_compressed.data(), numeric_cast< size_t >( length ) );
+            
+            column.clear();
+        }
+        
+        this->_index.insert( this->_index.end(), entry.begin(), entry.end() );
+        
+        this->_instructions += this->_chunk.instructions;
+        this->_chunks       += 1;
+        this->_chunk         = {};
+        
+        this->_chunk.codeBegin  = std::numeric_limits< uint32_t >::max();
+        this->_chunk.writeBegin = std::numeric_limits< uint32_t >::max();
+        
+        this->_code.clear();
+    }
+    
+    void TraceFile::Writer::IMPL::_write( const uint8_t * data, size_t size )
+    {
+        while( size > 0 )
+        {
+            ssize_t n( ::write( this->_fd, data, size ) );
+            
+            if( n < 0 && errno == EINTR )
+            {
+                continue;
+            }
+            
+            if( n <= 0 )
+            {
+                throw std::runtime_error( "Cannot write file: " + this->_path );
+            }
+            
+            data          += n;
+            size          -= static_cast< size_t >( n );
+            this->_offset += static_cast< uint64_t >( n );
+        }
+    }
+    
+    TraceFile::TraceFile( const std::string & path ):
+        impl( std::make_unique< IMPL >( path ) )
+    {}
+    
+    TraceFile::~TraceFile( void )
+    {}
+    
+    std::string TraceFile::path( void ) const
+    {
+        return this->impl->_path;
+    }
+    
+    bool TraceFile::registers( void ) const
+    {
+        return this->impl->_registers;
+    }
+    
+    uint64_t TraceFile::instructions( void ) const
+    {
+        return this->impl->_instructions;
+    }
+    
+    const std::vector< TraceFile::Chunk > & TraceFile::chunks( void ) const
+    {
+        return this->impl->_chunks;
+    }
+    
+    std::optional< TraceFile::Chunk > TraceFile::chunk( uint64_t instruction ) const
+    {
+        std::optional< size_t > index( this->impl->_find( instruction ) );
+        
+        if( index.has_value() == false )
+        {
+            return {};
+        }
+        
+        return this->impl->_chunks[ index.value() ];
+    }
+    
+    std::vector< TraceFile::Instruction > TraceFile::instructions( const Chunk & chunk, bool registers ) const
+    {
+        size_t                     index( this->impl->_index( chunk ) );
+        std::vector< Instruction > instructions;
+        std::vector< uint8_t >     code;
+        std::vector< uint8_t >     steps;
+        std::vector< uint8_t >     file;
+        
+        code  = this->impl->_column( index, Column::Code );
+        steps = this->impl->_column( index, Column::Steps );
+        
+        if( registers && this->impl->_registers )
+        {
+            file = this->impl->_column( index, Column::Registers );
+        }
+        
+        if( steps.size() != size_t( chunk.instructions ) * 4 || ( file.size() > 0 && file.size() != size_t( chunk.instructions ) * RegisterFileSize ) )
+        {
+            throw std::runtime_error( "Invalid trace chunk: " + this->impl->_path );
+        }
+        
+        {
+            BinaryDataStream stepStream( steps );
+            BinaryDataStream fileStream( file );
+            
+            for( uint32_t i = 0; i < chunk.instructions; i++ )
+            {
+                Instruction instruction;
+                uint32_t    offset( stepStream.ReadLittleEndianUInt32() );
+                
+                instruction.index   = chunk.first + i;
+                instruction.address = 0;
+                
+                if( offset != NotRecorded )
+                {
+                    if( offset + 5 > code.size() || offset + 5 + code[ offset + 4 ] > code.size() )
+                    {
+                        throw std::runtime_error( "Invalid trace chunk: " + this->impl->_path );
+                    }
+                    
+                    instruction.address = numeric_cast< uint32_t >( code[ offset ] | ( code[ offset + 1 ] << 8 ) | ( code[ offset + 2 ] << 16 ) | ( uint32_t( code[ offset + 3 ] ) << 24 ) );
+                    
+                    instruction.bytes.assign( code.begin() + offset + 5, code.begin() + offset + 5 + code[ offset + 4 ] );
+                }
+                
+                if( file.size() > 0 )
+                {
+                    RegisterFile r;
+                    
+                    r.eax    = fileStream.ReadLittleEndianUInt32();
+                    r.ebx    = fileStream.ReadLittleEndianUInt32();
+                    r.ecx    = fileStream.ReadLittleEndianUInt32();
+                    r.edx    = fileStream.ReadLittleEndianUInt32();
+                    r.esi    = fileStream.ReadLittleEndianUInt32();
+                    r.edi    = fileStream.ReadLittleEndianUInt32();
+                    r.esp    = fileStream.ReadLittleEndianUInt32();
+                    r.ebp    = fileStream.ReadLittleEndianUInt32();
+                    r.eip    = fileStream.ReadLittleEndianUInt32();
+                    r.eflags = fileStream.ReadLittleEndianUInt32();
+                    r.cs     = fileStream.ReadLittleEndianUInt16();
+                    r.ds     = fileStream.ReadLittleEndianUInt16();
+                    r.ss     = fileStream.ReadLittleEndianUInt16();
+                    r.es     = fileStream.ReadLittleEndianUInt16();
+                    r.fs     = fileStream.ReadLittleEndianUInt16();
+                    r.gs     = fileStream.ReadLittleEndianUInt16();
+                    
+                    instruction.registers = r;
+                }
+                
+                instructions.push_back( instruction );
+            }
+        }
+        
+        return instructions;
+    }
+    
+    std::vector< TraceFile::Write > TraceFile::writes( const Chunk & chunk ) const
+    {
+        std::vector< Write >   writes;
+        std::vector< uint8_t > data( this->impl->_column( this->impl->_index( chunk ), Column::Writes ) );
+        BinaryDataStream       stream( data );
+        
+        if( data.size() != size_t( chunk.writes ) * WriteSize )
+        {
+            throw std::runtime_error( "Invalid trace chunk: " + this->impl->_path );
+        }
+        
+        for( uint32_t i = 0; i < chunk.writes; i++ )
+        {
+            Write write;
+            
+            write.instruction = chunk.first + stream.ReadLittleEndianUInt32();
+            write.address     = stream.ReadLittleEndianUInt32();
+            write.size        = stream.ReadUInt8();
+            write.value       = stream.ReadLittleEndianUInt64();
+            
+            writes.push_back( write );
+        }
+        
+        return writes;
+    }
+    
+    TraceFile::IMPL::IMPL( const std::string & path ):
+        _path(         path ),
+        _fd(           -1 ),
+        _registers(    false ),
+        _instructions( 0 )
+    {
+        if( ( this->_fd = open( path.c_str(), O_RDONLY | O_CLOEXEC ) ) == -1 )
+        {
+            throw std::runtime_error( "Cannot open file: " + path );
+        }
+        
+        try
+        {
+            std::vector< uint8_t > header( HeaderSize );
+            std::vector< uint8_t > footer( FooterSize );
+            uint64_t               offset;
+            uint64_t               chunks;
+            off_t                  size( lseek( this->_fd, 0, SEEK_END ) );
+            
+            if( size < static_cast< off_t >( HeaderSize + FooterSize ) )
+            {
+                throw std::runtime_error( "Invalid trace file: " + path );
+            }
+            
+            Bytes::readAll( this->_fd, header.data(), header.size(), 0, path );
+            Bytes::readAll( this->_fd, footer.data(), footer.size(), static_cast< uint64_t >( size ) - FooterSize, path );
+            
+            {
+                BinaryDataStream stream( header );
+                
+                if( stream.ReadString( 8 ) != TraceFileMagic || stream.ReadLittleEndianUInt32() != TraceFileVersion )
+                {
+                    throw std::runtime_error( "Unsupported trace file: " + path );
+                }
+                
+                this->_registers = ( stream.ReadLittleEndianUInt32() & 1 ) != 0;
+            }
+            
+            {
+                BinaryDataStream stream( footer );
+                
+                offset = stream.ReadLittleEndianUInt64();
+                chunks = stream.ReadLittleEndianUInt64();
+                
+                if( stream.ReadString( 8 ) != TraceIndexMagic || offset + chunks * IndexEntrySize + FooterSize != static_cast< uint64_t >( size ) )
+                {
+                    throw std::runtime_error( "Invalid or incomplete trace file: " + path );
+                }
+            }
+            
+            {
+                std::vector< uint8_t > index( numeric_cast< size_t >( chunks * IndexEntrySize ) );
+                
+                Bytes::readAll( this->_fd, index.data(), index.size(), offset, path );
+                
+                {
+                    BinaryDataStream stream( index );
+                    
+                    for( uint64_t i = 0; i < chunks; i++ )
+                    {
+                        Chunk                                  chunk;
+                        std::array< ColumnEntry, ColumnCount > columns;
+                        
+                        chunk.first        = stream.ReadLittleEndianUInt64();
+                        chunk.instructions = stream.ReadLittleEndianUInt32();
+                        chunk.writes       = stream.ReadLittleEndianUInt32();
+                        chunk.lostWrites   = stream.ReadLittleEndianUInt32();
+                        chunk.codeBegin    = stream.ReadLittleEndianUInt32();
+                        chunk.codeEnd      = stream.ReadLittleEndianUInt32();
+                        chunk.writeBegin   = stream.ReadLittleEndianUInt32();
+                        chunk.writeEnd     = stream.ReadLittleEndianUInt32();
+                        
+                        for( auto & column: columns )
+                        {
+                            column.offset = stream.ReadLittleEndianUInt64();
+                            column.length = stream.ReadLittleEndianUInt32();
+                            column.raw    = stream.ReadLittleEndianUInt32();
+                        }
+                        
+                        this->_instructions = chunk.first + chunk.instructions;
+                        
+                        this->_chunks.push_back( chunk );
+                        this->_columns.push_back( columns );
+                    }
+                }
+            }
+        }
+        catch( ... )
+        {
+            close( this->_fd );
+            
+            throw;
+        }
+    }
+    
+    TraceFile::IMPL::~IMPL( void )
+    {
+        if( this->_fd != -1 )
+        {
+            close( this->_fd );
+        }
+    }
+    
+    /*
+     * Chunks are sorted by first instruction number.
+     */
+    std::optional< size_t > TraceFile::IMPL::_find( uint64_t instruction ) const
+    {
+        auto it
+        (
+            std::upper_bound
+            (
+                this->_chunks.begin(),
+                this->_chunks.end(),
+                instruction,
+                []( uint64_t i, const Chunk & c ) -> bool
+                {
+                    return i < c.first;
+                }
+            )
+        );
+        
+        if( it == this->_chunks.begin() || std::prev( it )->contains( instruction ) == false )
+        {
+            return {};
+        }
+        
+        return static_cast< size_t >( std::prev( it ) - this->_chunks.begin() );
+    }
+    
+    size_t TraceFile::IMPL::_index( const Chunk & chunk ) const
+    {
+        std::optional< size_t > index( this->_find( chunk.first ) );
+        
+        if( index.has_value() == false || this->_chunks[ index.value() ].first != chunk.first )
+        {
+            throw std::runtime_error( "Invalid trace chunk" );
+        }
+        
+        return index.value();
+    }
+    
+    std::vector< uint8_t > TraceFile::IMPL::_column( size_t chunk, Column column ) const
+    {
+        const ColumnEntry    & entry( this->_columns[ chunk ][ static_cast< size_t >( column ) ] );
+        std::vector< uint8_t > compressed( entry.length );
+        std::vector< uint8_t > data( entry.raw );
+        uLongf                 length( entry.raw );
+        
+        if( entry.raw == 0 )
+        {
+            return data;
+        }
+        
+        Bytes::readAll( this->_fd, compressed.data(), compressed.size(), entry.offset, this->_path );
+        
+        if( uncompress( data.data(), &length, compressed.data(), numeric_cast< uLong >( compressed.size() ) ) != Z_OK || length != entry.raw )
+        {
+            throw std::runtime_error( "Invalid compressed column in trace file: " + this->_path );
+        }
+        
+        return data;
+    }
+}
+
+static void appendRegisters( std::vector< uint8_t > & data, const UB::RegisterFile & registers )
+{
+    UB::Bytes::appendLittleEndian( data, registers.eax,    4 );
+    UB::Bytes::appendLittleEndian( data, registers.ebx,    4 );
+    UB::Bytes::appendLittleEndian( data, registers.ecx,    4 );
+    UB::Bytes::appendLittleEndian( data, registers.edx,    4 );
+    UB::Bytes::appendLittleEndian( data, registers.esi,    4 );
+    UB::Bytes::appendLittleEndian( data, registers.edi,    4 );
+    UB::Bytes::appendLittleEndian( data, registers.esp,    4 );
+    UB::Bytes::appendLittleEndian( data, registers.ebp,    4 );
+    UB::Bytes::appendLittleEndian( data, registers.eip,    4 );
+    UB::Bytes::appendLittleEndian( data, registers.eflags, 4 );
+    UB::Bytes::appendLittleEndian( data, registers.cs,     2 );
+    UB::Bytes::appendLittleEndian( data, registers.ds,     2 );
+    UB::Bytes::appendLittleEndian( data, registers.ss,     2 );
+    UB::Bytes::appendLittleEndian( data, registers.es,     2 );
+    UB::Bytes::appendLittleEndian( data, registers.fs,     2 );
+    UB::Bytes::appendLittleEndian( data, registers.gs,     2 );
+}
@@ -0,0 +1,202 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef UB_TRACE_FILE_HPP
+#define UB_TRACE_FILE_HPP
+
+#include <memory>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <optional>
+#include "UB/RegisterFile.hpp"
+
+namespace UB
+{
+    /*
+     * Seekable execution trace container.
+     * 
+     * Instructions are grouped in chunks of ChunkSize instructions. Each
+     * chunk stores its columns separately, compressed with zlib, so they can
+     * be decoded independently. An index at the end of the file gives the
+     * first instruction number of each chunk, and the range of executed and
+     * written addresses, so chunks can be skipped without being decoded.
+     * All values are little endian.
+     * 
+     *     Header:      Magic           8 bytes     "UBTRACE\0"
+     *                  Version         4 bytes     3
+     *                  Flags           4 bytes     1 if registers are recorded
+     *     
+     *     Chunks:      Columns, stored consecutively
+     *     
+     *     Index entry: First           8 bytes     First instruction number
+     *                  Instructions    4 bytes
+     *                  Writes          4 bytes
+     *                  Lost writes     4 bytes     Number of writes dropped
+     *                                              while recording
+     *                  Code range      8 bytes     Lowest and highest address
+     *                  Write range     8 bytes     Lowest and highest address
+     *                  Columns         4 x 16      Offset (8 bytes), stored and
+     *                                              raw length (4 bytes each)
+     *     
+     *     Footer:      Index offset    8 bytes
+     *                  Chunks          8 bytes
+     *                  Magic           8 bytes     "UBTRIDX\0"
+     * 
+     * Columns:
+     * 
+     *     Code:        Distinct instructions of the chunk: address (4 bytes),
+     *                  size (1 byte) and bytes.
+     *     Steps:       Index in the code column of each instruction (4 bytes),
+     *                  or 0xFFFFFFFF for an instruction that was not recorded.
+     *     Registers:   Registers before each instruction, in RegisterFile
+     *                  order (52 bytes per instruction), if recorded.
+     *     Writes:      Memory writes: instruction number relative to the
+     *                  chunk (4 bytes), address (4 bytes), size (1 byte) and
+     *                  value (8 bytes).
+     *                  Writes dropped while recording are stored with a
+     *                  size of 0 and their number as value.
+     * 
+     * Empty ranges have their lowest address greater than their highest.
+     */
+    class TraceFile
+    {
+        public:
+            
+            static constexpr size_t ChunkSize = 64 * 1024;
+            
+            class Instruction
+            {
+                public:
+                    
+                    uint64_t                      index;
+                    uint32_t                      address;
+                    std::vector< uint8_t >        bytes;
+                    std::optional< RegisterFile > registers;
+                    
+                    /*
+                     * Instructions dropped while recording have no bytes.
+                     */
+                    bool recorded( void ) const;
+            };
+            
+            class Write
+            {
+                public:
+                    
+                    uint64_t instruction;
+                    uint32_t address;
+                    uint8_t  size;
+                    uint64_t value;
+                    
+                    /*
+                     * Writes dropped while recording, whose number is the
+                     * value.
+                     */
+                    bool lost( void ) const;
+            };
+            
+            class Chunk
+            {
+                public:
+                    
+                    uint64_t first;
+                    uint32_t instructions;
+                    uint32_t writes;
+                    uint32_t lostWrites;
+                    uint32_t codeBegin;
+                    uint32_t codeEnd;
+                    uint32_t writeBegin;
+                    uint32_t writeEnd;
+                    
+                    bool contains( uint64_t instruction )        const;
+                    bool executes( uint32_t begin, uint32_t end ) const;
+                    bool writesTo( uint32_t begin, uint32_t end ) const;
+            };
+            
+            /*
+             * Builds a trace file. Not thread-safe.
+             */
+            class Writer
+            {
+                public:
+                    
+                    Writer( const std::string & path, bool registers );
+                    ~Writer( void );
+                    
+                    Writer( const Writer & o )              = delete;
+                    Writer( Writer && o )                   = delete;
+                    Writer & operator =( const Writer & o ) = delete;
+                    Writer & operator =( Writer && o )      = delete;
+                    
+                    void instruction( uint32_t address, const uint8_t * bytes, size_t size, const RegisterFile & registers );
+                    void lost( uint64_t count );
+                    void write( uint32_t address, uint8_t size, uint64_t value );
+                    void lostWrites( uint64_t count );
+                    
+                    /*
+                     * Writes the last chunk and the index.
+                     * The file is unusable if this isn't called.
+                     */
+                    void finish( void );
+                    
+                private:
+                    
+                    class IMPL;
+                    std::unique_ptr< IMPL > impl;
+            };
+            
+            TraceFile( const std::string & path );
+            ~TraceFile( void );
+            
+            TraceFile( const TraceFile & o )              = delete;
+            TraceFile( TraceFile && o )                   = delete;
+            TraceFile & operator =( const TraceFile & o ) = delete;
+            TraceFile & operator =( TraceFile && o )      = delete;
+            
+            std::string                  path( void )         const;
+            bool                         registers( void )    const;
+            uint64_t                     instructions( void ) const;
+            const std::vector< Chunk > & chunks( void )       const;
+            
+            /*
+             * Finds the chunk containing an instruction number.
+             */
+            std::optional< Chunk > chunk( uint64_t instruction ) const;
+            
+            /*
+             * Only the columns needed are decoded.
+             */
+            std::vector< Instruction > instructions( const Chunk & chunk, bool registers ) const;
+            std::vector< Write >       writes( const Chunk & chunk )                       const;
+            
+        private:
+            
+            class IMPL;
+            std::unique_ptr< IMPL > impl;
+    };
+}
+
+#endif /* UB_TRACE_FILE_HPP */
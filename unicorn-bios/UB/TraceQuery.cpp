@@ -0,0 +1,263 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "UB/TraceQuery.hpp"
+#include "UB/Capstone.hpp"
+#include "UB/String.hpp"
+#include <iomanip>
+#include <stdexcept>
+
+static void printInstruction( const UB::TraceFile::Instruction & instruction, std::ostream & os );
+static void printRegisters( const UB::RegisterFile & registers, std::ostream & os );
+
+namespace UB
+{
+    namespace TraceQuery
+    {
+        std::pair< uint32_t, uint32_t > range( const std::string & s )
+        {
+            size_t   separator( s.find( ':' ) );
+            uint32_t begin;
+            uint32_t end;
+            
+            if( separator == std::string::npos )
+            {
+                begin = String::fromHex< uint32_t >( s );
+                end   = begin;
+            }
+            else
+            {
+                begin = String::fromHex< uint32_t >( s.substr( 0, separator ) );
+                end   = String::fromHex< uint32_t >( s.substr( separator + 1 ) );
+            }
+            
+            if( end < begin )
+            {
+                throw std::runtime_error( "Invalid address range: " + s );
+            }
+            
+            return { begin, end };
+        }
+        
+        void summary( const TraceFile & file, std::ostream & os )
+        {
+            uint64_t writes( 0 );
+            uint64_t lost( 0 );
+            
+            for( const auto & chunk: file.chunks() )
+            {
+                writes += chunk.writes;
+                lost   += chunk.lostWrites;
+            }
+            
+            os << "Trace:"
+               << std::endl
+               << "    - File:         " << file.path()
+               << std::endl
+               << "    - Instructions: " << file.instructions()
+               << std::endl
+               << "    - Writes:       " << writes
+               << std::endl
+               << "    - Lost writes:  " << lost
+               << std::endl
+               << "    - Chunks:       " << file.chunks().size()
+               << std::endl
+               << "    - Registers:    " << ( ( file.registers() ) ? "Yes" : "No" )
+               << std::endl;
+        }
+        
+        void instructions( const TraceFile & file, uint64_t first, size_t count, std::ostream & os )
+        {
+            std::optional< TraceFile::Chunk > chunk( file.chunk( first ) );
+            
+            while( count > 0 && chunk.has_value() )
+            {
+                for( const auto & instruction: file.instructions( chunk.value(), file.registers() ) )
+                {
+                    if( instruction.index < first )
+                    {
+                        continue;
+                    }
+                    
+                    if( count == 0 )
+                    {
+                        break;
+                    }
+                    
+                    printInstruction( instruction, os );
+                    
+                    count--;
+                }
+                
+                chunk = file.chunk( chunk->first + chunk->instructions );
+            }
+        }
+        
+        void writes( const TraceFile & file, uint32_t begin, uint32_t end, size_t count, std::ostream & os )
+        {
+            for( const auto & chunk: file.chunks() )
+            {
+                if( count == 0 )
+                {
+                    break;
+                }
+                
+                if( chunk.lostWrites == 0 && chunk.writesTo( begin, end ) == false )
+                {
+                    continue;
+                }
+                
+                for( const auto & write: file.writes( chunk ) )
+                {
+                    if( count == 0 )
+                    {
+                        break;
+                    }
+                    
+                    /*
+                     * Lost writes may have targeted the range, so they are
+                     * always shown.
+                     */
+                    if( write.lost() )
+                    {
+                        os << std::setw( 12 ) << write.instruction
+                           << "  <" << write.value << " writes lost>"
+                           << std::endl;
+                        
+                        count--;
+                        
+                        continue;
+                    }
+                    
+                    /*
+                     * Writes overlapping the range are included.
+                     */
+                    if( write.address > end || static_cast< uint64_t >( write.address ) + write.size <= begin )
+                    {
+                        continue;
+                    }
+                    
+                    os << std::setw( 12 ) << write.instruction
+                       << "  "
+                       << String::toHex( write.address )
+                       << "  "
+                       << static_cast< unsigned int >( write.size )
+                       << "  ";
+                    
+                    switch( write.size )
+                    {
+                        case 1:  os << String::toHex( static_cast< uint8_t  >( write.value ) ); break;
+                        case 2:  os << String::toHex( static_cast< uint16_t >( write.value ) ); break;
+                        case 4:  os << String::toHex( static_cast< uint32_t >( write.value ) ); break;
+                        default: os << String::toHex( write.value );                            break;
+                    }
+                    
+                    os << std::endl;
+                    
+                    count--;
+                }
+            }
+        }
+        
+        void executions( const TraceFile & file, uint32_t begin, uint32_t end, size_t count, std::ostream & os )
+        {
+            for( const auto & chunk: file.chunks() )
+            {
+                if( count == 0 )
+                {
+                    break;
+                }
+                
+                if( chunk.executes( begin, end ) == false )
+                {
+                    continue;
+                }
+                
+                for( const auto & instruction: file.instructions( chunk, file.registers() ) )
+                {
+                    if( count == 0 )
+                    {
+                        break;
+                    }
+                    
+                    if( instruction.recorded() == false || instruction.address < begin || instruction.address > end )
+                    {
+                        continue;
+                    }
+                    
+                    printInstruction( instruction, os );
+                    
+                    count--;
+                }
+            }
+        }
+    }
+}
+
+static void printInstruction( const UB::TraceFile::Instruction & instruction, std::ostream & os )
+{
+    os << std::setw( 12 ) << instruction.index << "  ";
+    
+    if( instruction.recorded() == false )
+    {
+        os << "<lost>" << std::endl;
+        
+        return;
+    }
+    
+    {
+        auto disassembly( UB::Capstone::disassemble( instruction.bytes.data(), instruction.bytes.size(), instruction.address ) );
+        
+        os << UB::String::toHex( instruction.address )
+           << "  "
+           << std::left
+           << std::setw( 32 )
+           << ( ( disassembly.size() > 0 ) ? disassembly[ 0 ].second : std::string( "<invalid>" ) )
+           << std::right;
+    }
+    
+    if( instruction.registers.has_value() )
+    {
+        printRegisters( instruction.registers.value(), os );
+    }
+    
+    os << std::endl;
+}
+
+static void printRegisters( const UB::RegisterFile & registers, std::ostream & os )
+{
+    os << " EAX="     << UB::String::toHex( registers.eax )
+       << " EBX="     << UB::String::toHex( registers.ebx )
+       << " ECX="     << UB::String::toHex( registers.ecx )
+       << " EDX="     << UB::String::toHex( registers.edx )
+       << " ESI="     << UB::String::toHex( registers.esi )
+       << " EDI="     << UB::String::toHex( registers.edi )
+       << " ESP="     << UB::String::toHex( registers.esp )
+       << " EBP="     << UB::String::toHex( registers.ebp )
+       << " EFLAGS="  << UB::String::toHex( registers.eflags )
+       << " CS="      << UB::String::toHex( registers.cs )
+       << " DS="      << UB::String::toHex( registers.ds )
+       << " SS="      << UB::String::toHex( registers.ss )
+       << " ES="      << UB::String::toHex( registers.es );
+}
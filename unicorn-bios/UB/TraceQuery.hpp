@@ -0,0 +1,55 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef UB_TRACE_QUERY_HPP
+#define UB_TRACE_QUERY_HPP
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <ostream>
+#include "UB/TraceFile.hpp"
+
+namespace UB
+{
+    /*
+     * Prints the content of a TraceFile.
+     * Chunks that can't match a query are skipped using the file's index,
+     * without being decoded.
+     */
+    namespace TraceQuery
+    {
+        /*
+         * Parses an inclusive hexadecimal address range: BEGIN[:END].
+         */
+        std::pair< uint32_t, uint32_t > range( const std::string & s );
+        
+        void summary(      const TraceFile & file, std::ostream & os );
+        void instructions( const TraceFile & file, uint64_t first, size_t count, std::ostream & os );
+        void writes(       const TraceFile & file, uint32_t begin, uint32_t end, size_t count, std::ostream & os );
+        void executions(   const TraceFile & file, uint32_t begin, uint32_t end, size_t count, std::ostream & os );
+    }
+}
+
+#endif /* UB_TRACE_QUERY_HPP */
@@ -0,0 +1,632 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "UB/TraceRecorder.hpp"
+#include "UB/TraceFile.hpp"
+#include "UB/Engine.hpp"
+#include "UB/RegisterFile.hpp"
+#include "UB/Bytes.hpp"
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <optional>
+#include <limits>
+#include <cstring>
+#include <stdexcept>
+
+/*
+ * Records in the ring buffer use a compact encoding, decoded by the writer
+ * thread. All values are little endian.
+ * 
+ *     Instruction: Tag         1 byte      Bits 0-3: instruction size
+ *                                          Bits 4-5: address encoding
+ *                                          Bit  6:   registers follow
+ *                  Address     0-4 bytes
+ *                  Registers   0-54 bytes
+ *                  Bytes       1-15 bytes
+ *     
+ *     Lost:        Tag         1 byte      0
+ *                  Count       8 bytes     Number of dropped instructions
+ *     
+ *     Write:       Tag         1 byte      0x80 | size of the write
+ *                  Address     4 bytes
+ *                  Value       8 bytes
+ *     
+ *     Lost writes: Tag         1 byte      0x80
+ *                  Count       8 bytes     Number of dropped writes
+ * 
+ * Unless absolute, addresses are encoded as a signed delta from the end of
+ * the previous instruction: none (sequential), 1 or 2 bytes.
+ * Registers are encoded as a 2 bytes mask of the registers that changed
+ * since the previous record, in RegisterFile order, followed by their
+ * values (4 bytes, or 2 bytes for segment registers).
+ * After a lost record, the address is absolute and all registers are
+ * present.
+ * Lost records are written before the next recorded instruction, lost
+ * instructions first, so lost writes belong to the last instruction
+ * before them.
+ */
+static constexpr size_t  MaxRecordSize = 9 + 9 + 1 + 4 + 2 + 10 * 4 + 6 * 2 + 15;
+static constexpr uint8_t WriteTag      = 0x80;
+static constexpr uint8_t RegistersTag  = 0x40;
+
+namespace UB
+{
+    class TraceRecorder::IMPL
+    {
+        public:
+            
+            enum class Encoding: uint8_t
+            {
+                Sequential = 0,
+                Delta8     = 1,
+                Delta16    = 2,
+                Absolute   = 3
+            };
+            
+            IMPL( Engine & engine, const std::string & path, bool registers, bool writes, size_t bufferSize );
+            ~IMPL( void );
+            
+            void   _record( uint64_t address, size_t size );
+            void   _recordWrite( uint64_t address, size_t size, uint64_t value );
+            bool   _push( const uint8_t * data, size_t size );
+            void   _drain( void );
+            size_t _decode( const uint8_t * data );
+            void   _stop( void );
+            
+            static uint32_t RegisterFile::* const Registers[ 10 ];
+            static uint16_t RegisterFile::* const Segments[ 6 ];
+            
+            Engine                    & _engine;
+            std::string                 _path;
+            bool                        _registers;
+            std::vector< uint8_t >      _buffer;
+            uint64_t                    _mask;
+            std::optional< uint64_t >   _handler;
+            std::optional< uint64_t >   _writeHandler;
+            std::thread                 _writer;
+            std::atomic< bool >         _stopping;
+            std::atomic< bool >         _failed;
+            std::string                 _error;
+            std::atomic< uint64_t >     _instructions;
+            std::atomic< uint64_t >     _dropped;
+            std::atomic< uint64_t >     _droppedWrites;
+            
+            /*
+             * Ring buffer positions, on separate cache lines.
+             * The head is only written by the emulation thread, and the
+             * tail only by the writer thread.
+             */
+            alignas( 64 ) std::atomic< uint64_t > _head;
+            alignas( 64 ) std::atomic< uint64_t > _tail;
+            
+            /*
+             * Encoder state, only used by the emulation thread.
+             */
+            alignas( 64 ) uint64_t _next;
+            RegisterFile           _last;
+            bool                   _resync;
+            uint64_t               _lost;
+            uint64_t               _lostWrites;
+            
+            /*
+             * Decoder state, only used by the writer thread.
+             */
+            alignas( 64 ) std::unique_ptr< TraceFile::Writer > _file;
+            std::vector< uint8_t >                             _staging;
+            uint64_t                                           _decodeNext;
+            RegisterFile                                       _decodeRegisters;
+    };
+    
+    uint32_t RegisterFile::* const TraceRecorder::IMPL::Registers[ 10 ] =
+    {
+        &RegisterFile::eax,
+        &RegisterFile::ebx,
+        &RegisterFile::ecx,
+        &RegisterFile::edx,
+        &RegisterFile::esi,
+        &RegisterFile::edi,
+        &RegisterFile::esp,
+        &RegisterFile::ebp,
+        &RegisterFile::eip,
+        &RegisterFile::eflags
+    };
+    
+    uint16_t RegisterFile::* const TraceRecorder::IMPL::Segments[ 6 ] =
+    {
+        &RegisterFile::cs,
+        &RegisterFile::ds,
+        &RegisterFile::ss,
+        &RegisterFile::es,
+        &RegisterFile::fs,
+        &RegisterFile::gs
+    };
+    
+    TraceRecorder::TraceRecorder( Engine & engine, const std::string & path, bool registers, bool writes, size_t bufferSize ):
+        impl( std::make_unique< IMPL >( engine, path, registers, writes, bufferSize ) )
+    {}
+    
+    TraceRecorder::~TraceRecorder( void )
+    {}
+    
+    std::string TraceRecorder::path( void ) const
+    {
+        return this->impl->_path;
+    }
+    
+    uint64_t TraceRecorder::instructions( void ) const
+    {
+        return this->impl->_instructions;
+    }
+    
+    uint64_t TraceRecorder::dropped( void ) const
+    {
+        return this->impl->_dropped;
+    }
+    
+    uint64_t TraceRecorder::droppedWrites( void ) const
+    {
+        return this->impl->_droppedWrites;
+    }
+    
+    void TraceRecorder::stop( void )
+    {
+        this->impl->_stop();
+        
+        if( this->impl->_failed )
+        {
+            throw std::runtime_error( this->impl->_error );
+        }
+    }
+    
+    TraceRecorder::IMPL::IMPL( Engine & engine, const std::string & path, bool registers, bool writes, size_t bufferSize ):
+        _engine(          engine ),
+        _path(            path ),
+        _registers(       registers ),
+        _mask(            0 ),
+        _stopping(        false ),
+        _failed(          false ),
+        _instructions(    0 ),
+        _dropped(         0 ),
+        _droppedWrites(   0 ),
+        _head(            0 ),
+        _tail(            0 ),
+        _next(            0 ),
+        _last(            {} ),
+        _resync(          true ),
+        _lost(            0 ),
+        _lostWrites(      0 ),
+        _file(            std::make_unique< TraceFile::Writer >( path, registers ) ),
+        _decodeNext(      0 ),
+        _decodeRegisters( {} )
+    {
+        size_t size( 4096 );
+        
+        /*
+         * The ring buffer's size is a power of two, so positions can be
+         * masked instead of wrapped.
+         */
+        while( size < bufferSize )
+        {
+            size *= 2;
+        }
+        
+        this->_buffer.resize( size );
+        this->_staging.reserve( size );
+        
+        this->_mask = size - 1;
+        
+        /*
+         * The writer is started last, so it never has to be stopped if
+         * registering a handler fails, but the registered ones must then
+         * be removed.
+         */
+        try
+        {
+            this->_handler = this->_engine.onExecute
+            (
+                0,
+                std::numeric_limits< uint64_t >::max(),
+                [ this ]( uint64_t instruction, size_t length )
+                {
+                    this->_record( instruction, length );
+                }
+            );
+            
+            if( writes )
+            {
+                this->_writeHandler = this->_engine.onMemoryWrite
+                (
+                    [ this ]( uint64_t target, size_t length, uint64_t value )
+                    {
+                        this->_recordWrite( target, length, value );
+                    }
+                );
+            }
+            
+            this->_writer = std::thread( [ this ] { this->_drain(); } );
+        }
+        catch( ... )
+        {
+            this->_stop();
+            
+            throw;
+        }
+    }
+    
+    TraceRecorder::IMPL::~IMPL( void )
+    {
+        this->_stop();
+    }
+    
+    void TraceRecorder::IMPL::_stop( void )
+    {
+        if( this->_handler.has_value() )
+        {
+            this->_engine.removeExecuteHandler( this->_handler.value() );
+            this->_handler.reset();
+        }
+        
+        if( this->_writeHandler.has_value() )
+        {
+            this->_engine.removeMemoryWriteHandler( this->_writeHandler.value() );
+            this->_writeHandler.reset();
+        }
+        
+        this->_stopping = true;
+        
+        if( this->_writer.joinable() )
+        {
+            this->_writer.join();
+        }
+    }
+    
+    /*
+     * Called by the emulation thread for every instruction, so it never
+     * allocates, locks or blocks.
+     */
+    void TraceRecorder::IMPL::_record( uint64_t address, size_t size )
+    {
+        uint8_t  record[ MaxRecordSize ];
+        size_t   n( 0 );
+        size_t   tag;
+        int64_t  delta( static_cast< int64_t >( address - this->_next ) );
+        Encoding encoding;
+        
+        if( this->_lost > 0 )
+        {
+            record[ n++ ] = 0;
+            n            += Bytes::putLittleEndian( record + n, this->_lost, 8 );
+        }
+        
+        if( this->_lostWrites > 0 )
+        {
+            record[ n++ ] = WriteTag;
+            n            += Bytes::putLittleEndian( record + n, this->_lostWrites, 8 );
+        }
+        
+        if( this->_resync )
+        {
+            encoding = Encoding::Absolute;
+        }
+        else if( delta == 0 )
+        {
+            encoding = Encoding::Sequential;
+        }
+        else if( delta >= std::numeric_limits< int8_t >::min() && delta <= std::numeric_limits< int8_t >::max() )
+        {
+            encoding = Encoding::Delta8;
+        }
+        else if( delta >= std::numeric_limits< int16_t >::min() && delta <= std::numeric_limits< int16_t >::max() )
+        {
+            encoding = Encoding::Delta16;
+        }
+        else
+        {
+            encoding = Encoding::Absolute;
+        }
+        
+        tag           = n;
+        record[ n++ ] = static_cast< uint8_t >( ( size & 0x0F ) | ( static_cast< uint8_t >( encoding ) << 4 ) );
+        
+        switch( encoding )
+        {
+            case Encoding::Sequential:                                                                              break;
+            case Encoding::Delta8:     n += Bytes::putLittleEndian( record + n, static_cast< uint64_t >( delta ), 1 ); break;
+            case Encoding::Delta16:    n += Bytes::putLittleEndian( record + n, static_cast< uint64_t >( delta ), 2 ); break;
+            case Encoding::Absolute:   n += Bytes::putLittleEndian( record + n, address,                          4 ); break;
+        }
+        
+        if( this->_registers )
+        {
+            RegisterFile file( this->_engine.hookSnapshot() );
+            size_t       mask( n );
+            uint16_t     changed( 0 );
+            
+            n += 2;
+            
+            for( size_t i = 0; i < 10; i++ )
+            {
+                if( this->_resync || file.*( Registers[ i ] ) != this->_last.*( Registers[ i ] ) )
+                {
+                    changed |= static_cast< uint16_t >( 1 << i );
+                    n       += Bytes::putLittleEndian( record + n, file.*( Registers[ i ] ), 4 );
+                }
+            }
+            
+            for( size_t i = 0; i < 6; i++ )
+            {
+                if( this->_resync || file.*( Segments[ i ] ) != this->_last.*( Segments[ i ] ) )
+                {
+                    changed |= static_cast< uint16_t >( 1 << ( i + 10 ) );
+                    n       += Bytes::putLittleEndian( record + n, file.*( Segments[ i ] ), 2 );
+                }
+            }
+            
+            if( changed != 0 )
+            {
+                record[ tag ] |= RegistersTag;
+                
+                Bytes::putLittleEndian( record + mask, changed, 2 );
+            }
+            else
+            {
+                n = mask;
+            }
+            
+            this->_last = file;
+        }
+        
+        /*
+         * Instructions executed outside of the allocated memory can't be
+         * read, and are recorded as zeros.
+         */
+        try
+        {
+            memcpy( record + n, this->_engine.view( address, size ), size );
+        }
+        catch( const std::exception & )
+        {
+            memset( record + n, 0, size );
+        }
+        
+        n += size;
+        
+        this->_instructions++;
+        
+        if( this->_push( record, n ) == false )
+        {
+            this->_lost++;
+            this->_dropped++;
+            
+            this->_resync = true;
+            
+            return;
+        }
+        
+        this->_lost       = 0;
+        this->_lostWrites = 0;
+        this->_resync     = false;
+        this->_next       = address + size;
+    }
+    
+    /*
+     * Writes follow the instruction performing them. Once a record was
+     * dropped, following writes are also dropped until the next recorded
+     * instruction, so the gap is marked in the file.
+     */
+    void TraceRecorder::IMPL::_recordWrite( uint64_t address, size_t size, uint64_t value )
+    {
+        uint8_t record[ 13 ];
+        
+        if( this->_resync )
+        {
+            this->_lostWrites++;
+            this->_droppedWrites++;
+            
+            return;
+        }
+        
+        record[ 0 ] = static_cast< uint8_t >( WriteTag | ( size & 0x0F ) );
+        
+        Bytes::putLittleEndian( record + 1, address, 4 );
+        Bytes::putLittleEndian( record + 5, value,   8 );
+        
+        if( this->_push( record, sizeof( record ) ) == false )
+        {
+            this->_lostWrites++;
+            this->_droppedWrites++;
+            
+            this->_resync = true;
+        }
+    }
+    
+    bool TraceRecorder::IMPL::_push( const uint8_t * data, size_t size )
+    {
+        uint64_t head( this->_head.load( std::memory_order_relaxed ) );
+        uint64_t tail( this->_tail.load( std::memory_order_acquire ) );
+        size_t   offset( head & this->_mask );
+        size_t   first( std::min( size, this->_buffer.size() - offset ) );
+        
+        if( this->_buffer.size() - ( head - tail ) < size )
+        {
+            return false;
+        }
+        
+        memcpy( this->_buffer.data() + offset, data,         first );
+        memcpy( this->_buffer.data(),          data + first, size - first );
+        
+        this->_head.store( head + size, std::memory_order_release );
+        
+        return true;
+    }
+    
+    /*
+     * Writer thread.
+     * Everything available is moved out of the ring buffer at once, so it's
+     * freed as soon as possible, and then decoded to the trace file.
+     * Records are always pushed whole, so available data never ends with a
+     * partial record.
+     */
+    void TraceRecorder::IMPL::_drain( void )
+    {
+        while( true )
+        {
+            bool     stopping( this->_stopping );
+            uint64_t tail( this->_tail.load( std::memory_order_relaxed ) );
+            uint64_t head( this->_head.load( std::memory_order_acquire ) );
+            
+            if( head == tail )
+            {
+                if( stopping )
+                {
+                    break;
+                }
+                
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+                
+                continue;
+            }
+            
+            {
+                size_t offset( tail & this->_mask );
+                size_t size( head - tail );
+                size_t first( std::min( size, this->_buffer.size() - offset ) );
+                
+                this->_staging.resize( size );
+                
+                memcpy( this->_staging.data(),         this->_buffer.data() + offset, first );
+                memcpy( this->_staging.data() + first, this->_buffer.data(),          size - first );
+                
+                this->_tail.store( head, std::memory_order_release );
+            }
+            
+            /*
+             * After an error, records are still consumed, so the emulation
+             * isn't affected, but discarded.
+             */
+            if( this->_failed )
+            {
+                continue;
+            }
+            
+            try
+            {
+                for( size_t i = 0; i < this->_staging.size(); )
+                {
+                    i += this->_decode( this->_staging.data() + i );
+                }
+            }
+            catch( const std::exception & e )
+            {
+                this->_error  = e.what();
+                this->_failed = true;
+            }
+        }
+        
+        if( this->_failed == false )
+        {
+            try
+            {
+                this->_file->finish();
+            }
+            catch( const std::exception & e )
+            {
+                this->_error  = e.what();
+                this->_failed = true;
+            }
+        }
+        
+        this->_file.reset();
+    }
+    
+    size_t TraceRecorder::IMPL::_decode( const uint8_t * data )
+    {
+        size_t   n( 1 );
+        uint8_t  tag( data[ 0 ] );
+        size_t   size( tag & 0x0F );
+        uint64_t address;
+        
+        if( tag == WriteTag )
+        {
+            this->_file->lostWrites( Bytes::getLittleEndian( data + 1, 8 ) );
+            
+            return 9;
+        }
+        
+        if( tag & WriteTag )
+        {
+            this->_file->write( static_cast< uint32_t >( Bytes::getLittleEndian( data + 1, 4 ) ), static_cast< uint8_t >( size ), Bytes::getLittleEndian( data + 5, 8 ) );
+            
+            return 13;
+        }
+        
+        if( tag == 0 )
+        {
+            this->_file->lost( Bytes::getLittleEndian( data + 1, 8 ) );
+            
+            return 9;
+        }
+        
+        switch( static_cast< Encoding >( ( tag >> 4 ) & 3 ) )
+        {
+            case Encoding::Sequential: address = this->_decodeNext;                                                                                                 break;
+            case Encoding::Delta8:     address = this->_decodeNext + static_cast< uint64_t >( static_cast< int8_t >(  Bytes::getLittleEndian( data + n, 1 ) ) ); n += 1; break;
+            case Encoding::Delta16:    address = this->_decodeNext + static_cast< uint64_t >( static_cast< int16_t >( Bytes::getLittleEndian( data + n, 2 ) ) ); n += 2; break;
+            case Encoding::Absolute:   address = Bytes::getLittleEndian( data + n, 4 );                                                                        n += 4; break;
+        }
+        
+        if( tag & RegistersTag )
+        {
+            uint16_t changed( static_cast< uint16_t >( Bytes::getLittleEndian( data + n, 2 ) ) );
+            
+            n += 2;
+            
+            for( size_t i = 0; i < 10; i++ )
+            {
+                if( changed & ( 1 << i ) )
+                {
+                    this->_decodeRegisters.*( Registers[ i ] ) = static_cast< uint32_t >( Bytes::getLittleEndian( data + n, 4 ) );
+                    n                                         += 4;
+                }
+            }
+            
+            for( size_t i = 0; i < 6; i++ )
+            {
+                if( changed & ( 1 << ( i + 10 ) ) )
+                {
+                    this->_decodeRegisters.*( Segments[ i ] ) = static_cast< uint16_t >( Bytes::getLittleEndian( data + n, 2 ) );
+                    n                                        += 2;
+                }
+            }
+        }
+        
+        this->_file->instruction( static_cast< uint32_t >( address ), data + n, size, this->_decodeRegisters );
+        
+        this->_decodeNext = address + size;
+        
+        return n + size;
+    }
+}
@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2019 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef UB_TRACE_RECORDER_HPP
+#define UB_TRACE_RECORDER_HPP
+
+#include <memory>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+
+namespace UB
+{
+    class Engine;
+    
+    /*
+     * Records every instruction executed by an engine to a TraceFile, and
+     * optionally the registers and memory writes.
+     * 
+     * Records are written by the emulation thread to a lock-free ring
+     * buffer, which is drained by a writer thread, so the emulation never
+     * waits for the disk or for compression. If the buffer is full, records
+     * are dropped, and dropped instructions and writes are marked as such
+     * in the file.
+     */
+    class TraceRecorder
+    {
+        public:
+            
+            static constexpr size_t DefaultBufferSize = 16 * 1024 * 1024;
+            
+            TraceRecorder( Engine & engine, const std::string & path, bool registers, bool writes, size_t bufferSize = DefaultBufferSize );
+            ~TraceRecorder( void );
+            
+            TraceRecorder( const TraceRecorder & o )              = delete;
+            TraceRecorder( TraceRecorder && o )                   = delete;
+            TraceRecorder & operator =( const TraceRecorder & o ) = delete;
+            TraceRecorder & operator =( TraceRecorder && o )      = delete;
+            
+            std::string path( void )          const;
+            uint64_t    instructions( void )  const;
+            uint64_t    dropped( void )       const;
+            uint64_t    droppedWrites( void ) const;
+            
+            /*
+             * Stops recording, and waits until all records are written.
+             * Must be called once the emulation has stopped, as the file is
+             * only complete once its index has been written.
+             * Throws if the file couldn't be written.
+             */
+            void stop( void );
+            
+        private:
+            
+            class IMPL;
+            std::unique_ptr< IMPL > impl;
+    };
+}
+
+#endif /* UB_TRACE_RECORDER_HPP */
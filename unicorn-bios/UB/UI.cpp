@@ -28,9 +28,10 @@
 #include "UB/Casts.hpp"
 #include "UB/Engine.hpp"
 #include "UB/Casts.hpp"
-#include "UB/Capstone.hpp"
+#include "UB/Disassembler.hpp"
 #include "UB/Window.hpp"
 #include "UB/Signal.hpp"
+#include "UB/Profiler.hpp"
 #include <mutex>
 #include <optional>
 #include <thread>
@@ -38,20 +39,50 @@
 #include <optional>
 #include <iostream>
 #include <condition_variable>
+#include <sstream>
+#include <iomanip>
+#include <atomic>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include <csignal>
 
+static uint64_t hashBytes( const void * data, size_t size, uint64_t seed = 0xCBF29CE484222325 );
+
 namespace UB
 {
     class UI::IMPL
     {
         public:
             
+            /*
+             * Persistent window for a pane, along with the signature of the
+             * data it displays, so it's only redrawn when the data changes.
+             */
+            class Pane
+            {
+                public:
+                    
+                    std::optional< Window >   window;
+                    std::optional< uint64_t > signature;
+            };
+            
             IMPL( Engine & engine );
             IMPL( const IMPL & o );
             IMPL( const IMPL & o, const std::lock_guard< std::recursive_mutex > & l );
+            ~IMPL( void );
             
             void _setupEngine( void );
+            void _setupPipe( void );
+            void _wakeup( void );
+            void _waitForExit( void );
             void _setupScreen( void );
+            void _setNeedsDisplay( void );
+            void _setContinuousDisplay( bool value );
+            void _resetPanes( void );
+            bool _updatePane( Pane & pane, size_t x, size_t y, size_t width, size_t height, uint64_t signature );
+            uint64_t _codeSignature( void ) const;
             void _displayStatus( void );
             void _displayOutput( void );
             void _displayDebug( void );
@@ -62,12 +93,16 @@ namespace UB
             void _displayInstructions( void );
             void _displayDisassembly( void );
             void _displayMemory( void );
+            void _displayProfile( void );
+            bool _profileVisible( void ) const;
             void _memoryScrollUp( size_t n = 1 );
             void _memoryScrollDown( size_t n = 1 );
             void _memoryPageUp( void );
             void _memoryPageDown( void );
             
             bool                          _running;
+            std::atomic< bool >           _exit;
+            int                           _pipe[ 2 ];
             Mode                          _mode;
             Engine                      & _engine;
             StringStream                  _output;
@@ -79,7 +114,21 @@ namespace UB
             size_t                        _memoryLines;
             std::optional< std::string >  _memoryAddressPrompt;
             std::function< void( int ) >  _waitEnterOrSpaceKeyPress;
+            Disassembler                  _disassembler;
+            bool                          _showProfile;
+            Pane                          _statusPane;
+            Pane                          _outputPane;
+            Pane                          _debugPane;
+            Pane                          _registersPane;
+            Pane                          _flagsPane;
+            Pane                          _stackPane;
+            Pane                          _instructionsPane;
+            Pane                          _disassemblyPane;
+            Pane                          _memoryPane;
+            Pane                          _profilePane;
             mutable std::recursive_mutex  _rmtx;
+            
+            std::shared_ptr< const Profiler > _profiler;
     };
     
     UI::UI( Engine & engine ):
@@ -139,14 +188,21 @@ namespace UB
             }
             
             this->impl->_running = true;
+            this->impl->_exit    = false;
             mode                 = this->impl->_mode;
             
-            this->impl->_output = {};
-            this->impl->_debug  = {};
+            this->impl->_output.clear();
+            this->impl->_debug.clear();
             
             if( mode == Mode::Interactive )
             {
                 this->impl->_setupScreen();
+                
+                /*
+                 * The engine may already be running, and its start handlers
+                 * called.
+                 */
+                Screen::shared().continuousDisplay( this->impl->_engine.running() );
             }
             else
             {
@@ -162,24 +218,19 @@ namespace UB
             (
                 [ & ]
                 {
-                    std::atomic< bool > exit( false );
-                    
-                    Signal::handle
-                    (
-                        SIGINT,
-                        [ & ]( int sig )
-                        {
-                            if( sig == SIGINT )
-                            {
-                                exit = true;
-                            }
-                            
-                            if( mode == Mode::Interactive )
+                    for( int sig: { SIGINT, SIGTERM } )
+                    {
+                        Signal::handle
+                        (
+                            sig,
+                            [ this ]( int s )
                             {
-                                Screen::shared().stop();
+                                ( void )s;
+                                
+                                this->stop();
                             }
-                        }
-                    );
+                        );
+                    }
                     
                     if( mode == Mode::Interactive )
                     {
@@ -187,10 +238,7 @@ namespace UB
                     }
                     else
                     {
-                        while( exit == false )
-                        {
-                            std::this_thread::yield();
-                        }
+                        this->impl->_waitForExit();
                     }
                     
                     {
@@ -219,6 +267,18 @@ namespace UB
         }
     }
     
+    void UI::stop( void )
+    {
+        this->impl->_exit = true;
+        
+        this->impl->_wakeup();
+        
+        if( this->impl->_mode == Mode::Interactive )
+        {
+            Screen::shared().stop();
+        }
+    }
+    
     int UI::waitForUserResume( void )
     {
         bool                        keyPressed( false );
@@ -261,6 +321,8 @@ namespace UB
                     
                     cv.notify_all();
                 };
+                
+                this->impl->_setNeedsDisplay();
             }
             
             {
@@ -294,6 +356,17 @@ namespace UB
         return this->impl->_debug;
     }
     
+    void UI::profiler( const std::shared_ptr< const Profiler > & profiler )
+    {
+        std::lock_guard< std::recursive_mutex > l( this->impl->_rmtx );
+        
+        this->impl->_profiler    = profiler;
+        this->impl->_showProfile = profiler != nullptr;
+        
+        this->impl->_resetPanes();
+        this->impl->_setNeedsDisplay();
+    }
+    
     void swap( UI & o1, UI & o2 )
     {
         std::lock( o1.impl->_rmtx, o2.impl->_rmtx );
@@ -310,14 +383,18 @@ namespace UB
     
     UI::IMPL::IMPL( Engine & engine ):
         _running(            false ),
+        _exit(               false ),
+        _pipe{               -1, -1 },
         _mode(               Mode::Interactive ),
         _engine(             engine ),
         _status(             "Emulation not running" ),
         _statusColor(        Color::red() ),
         _memoryOffset(       0x7C00 ),
         _memoryBytesPerLine( 0 ),
-        _memoryLines(        0 )
+        _memoryLines(        0 ),
+        _showProfile(        false )
     {
+        this->_setupPipe();
         this->_setupEngine();
     }
     
@@ -327,21 +404,34 @@ namespace UB
     
     UI::IMPL::IMPL( const IMPL & o, const std::lock_guard< std::recursive_mutex > & l ):
         _running(            false ),
+        _exit(               false ),
+        _pipe{               -1, -1 },
         _mode(               o._mode ),
         _engine(             o._engine ),
-        _output(             o._output.string() ),
-        _debug(              o._debug.string() ),
+        _output(             o._output ),
+        _debug(              o._debug ),
         _status(             "Emulation not running" ),
         _statusColor(        Color::red() ),
         _memoryOffset(       o._memoryOffset ),
         _memoryBytesPerLine( o._memoryBytesPerLine ),
-        _memoryLines(        o._memoryLines )
+        _memoryLines(        o._memoryLines ),
+        _showProfile(        false )
     {
         ( void )l;
         
+        this->_setupPipe();
         this->_setupEngine();
     }
     
+    UI::IMPL::~IMPL( void )
+    {
+        if( this->_pipe[ 0 ] != -1 )
+        {
+            close( this->_pipe[ 0 ] );
+            close( this->_pipe[ 1 ] );
+        }
+    }
+    
     void UI::IMPL::_setupEngine( void )
     {
         this->_engine.onStart
@@ -352,6 +442,9 @@ namespace UB
                 
                 this->_status      = "Emulation running...";
                 this->_statusColor = Color::green();
+                
+                this->_setContinuousDisplay( true );
+                this->_setNeedsDisplay();
             }
         );
         
@@ -363,20 +456,177 @@ namespace UB
                 
                 this->_status      = "Emulation stopped";
                 this->_statusColor = Color::red();
+                
+                this->_setContinuousDisplay( false );
+                this->_setNeedsDisplay();
+                
+                /*
+                 * Without user interface, there's nothing left to do once
+                 * the emulation has stopped.
+                 */
+                if( this->_mode == Mode::Standard )
+                {
+                    this->_wakeup();
+                }
             }
         );
     }
     
+    /*
+     * Self-pipe, used to wake up the standard mode's loop on SIGINT, when
+     * the emulation stops, or when the UI is explicitly stopped.
+     * Writing to a pipe is async-signal-safe.
+     */
+    void UI::IMPL::_setupPipe( void )
+    {
+        if( pipe( this->_pipe ) != 0 )
+        {
+            throw std::runtime_error( "Cannot create UI pipe" );
+        }
+        
+        fcntl( this->_pipe[ 0 ], F_SETFL, fcntl( this->_pipe[ 0 ], F_GETFL ) | O_NONBLOCK );
+        fcntl( this->_pipe[ 1 ], F_SETFL, fcntl( this->_pipe[ 1 ], F_GETFL ) | O_NONBLOCK );
+        fcntl( this->_pipe[ 0 ], F_SETFD, FD_CLOEXEC );
+        fcntl( this->_pipe[ 1 ], F_SETFD, FD_CLOEXEC );
+    }
+    
+    void UI::IMPL::_wakeup( void )
+    {
+        char c( 0 );
+        
+        if( this->_pipe[ 1 ] != -1 )
+        {
+            ( void )write( this->_pipe[ 1 ], &c, 1 );
+        }
+    }
+    
+    /*
+     * Blocks until the UI is stopped or the emulation has stopped.
+     * The engine is started before the UI runs, so it may already have
+     * stopped, in which case the pipe has already been written to.
+     */
+    void UI::IMPL::_waitForExit( void )
+    {
+        while( this->_exit == false && this->_engine.running() )
+        {
+            struct pollfd p;
+            
+            memset( &p, 0, sizeof( p ) );
+            
+            p.fd     = this->_pipe[ 0 ];
+            p.events = POLLIN;
+            
+            if( poll( &p, 1, -1 ) > 0 && ( p.revents & POLLIN ) )
+            {
+                char c[ 64 ];
+                
+                while( read( this->_pipe[ 0 ], c, sizeof( c ) ) > 0 )
+                {}
+            }
+        }
+    }
+    
+    void UI::IMPL::_resetPanes( void )
+    {
+        for( Pane * pane: { &( this->_statusPane ), &( this->_outputPane ), &( this->_debugPane ), &( this->_registersPane ), &( this->_flagsPane ), &( this->_stackPane ), &( this->_instructionsPane ), &( this->_disassemblyPane ), &( this->_memoryPane ), &( this->_profilePane ) } )
+        {
+            pane->window    = {};
+            pane->signature = {};
+        }
+    }
+    
+    /*
+     * Creates the pane's window if needed, and returns whether the pane
+     * needs to be drawn.
+     * The window is erased if so.
+     */
+    bool UI::IMPL::_updatePane( Pane & pane, size_t x, size_t y, size_t width, size_t height, uint64_t signature )
+    {
+        if( pane.window.has_value() == false || pane.window->x() != x || pane.window->y() != y || pane.window->width() != width || pane.window->height() != height )
+        {
+            pane.window.emplace( x, y, width, height );
+            
+            pane.signature = {};
+        }
+        
+        if( pane.signature == signature )
+        {
+            return false;
+        }
+        
+        pane.signature = signature;
+        
+        pane.window->erase();
+        
+        return true;
+    }
+    
+    /*
+     * Signature of the code at the current instruction pointer, for the
+     * instructions and disassembly panes.
+     */
+    uint64_t UI::IMPL::_codeSignature( void ) const
+    {
+        uint64_t ip( this->_engine.registers().eip() );
+        
+        try
+        {
+            return hashBytes( this->_engine.view( ip, 512 ), 512, ip );
+        }
+        catch( ... )
+        {
+            return ip;
+        }
+    }
+    
+    void UI::IMPL::_setNeedsDisplay( void )
+    {
+        std::lock_guard< std::recursive_mutex > l( this->_rmtx );
+        
+        if( this->_running && this->_mode == Mode::Interactive )
+        {
+            Screen::shared().setNeedsDisplay();
+        }
+    }
+    
+    /*
+     * Registers, memory and output change continuously while the emulation
+     * is running, so the screen is then updated at its frame rate.
+     */
+    void UI::IMPL::_setContinuousDisplay( bool value )
+    {
+        std::lock_guard< std::recursive_mutex > l( this->_rmtx );
+        
+        if( this->_running && this->_mode == Mode::Interactive )
+        {
+            Screen::shared().continuousDisplay( value );
+        }
+    }
+    
     void UI::IMPL::_setupScreen( void )
     {
+        Screen::shared().onResize
+        (
+            [ & ]( void )
+            {
+                this->_resetPanes();
+                
+                Screen::shared().clear();
+                Screen::shared().refresh();
+            }
+        );
+        
         Screen::shared().onUpdate
         (
             [ & ]( void )
             {
                 if( Screen::shared().width() < 50 || Screen::shared().height() < 30 )
                 {
+                    this->_resetPanes();
+                    
                     Screen::shared().clear();
                     Screen::shared().print( Color::red(), "Screen too small..." );
+                    Screen::shared().refresh();
                     
                     return;
                 }
@@ -387,6 +637,7 @@ namespace UB
                 this->_displayInstructions();
                 this->_displayDisassembly();
                 this->_displayMemory();
+                this->_displayProfile();
                 this->_displayOutput();
                 this->_displayDebug();
                 this->_displayStatus();
@@ -469,6 +720,17 @@ namespace UB
                     {
                         this->_memoryOffset = 0;
                     }
+                    else if( key == 'p' )
+                    {
+                        std::lock_guard< std::recursive_mutex > l( this->_rmtx );
+                        
+                        if( this->_profiler != nullptr )
+                        {
+                            this->_showProfile = this->_showProfile == false;
+                            
+                            this->_resetPanes();
+                        }
+                    }
                 }
             }
         );
@@ -480,7 +742,17 @@ namespace UB
         size_t y(      Screen::shared().height() - 3 );
         size_t width(  Screen::shared().width() );
         size_t height( 3 );
-        Window win( x, y, width, height );
+        
+        {
+            std::lock_guard< std::recursive_mutex > l( this->_rmtx );
+            
+            if( this->_updatePane( this->_statusPane, x, y, width, height, hashBytes( this->_status.data(), this->_status.size(), numeric_cast< uint64_t >( this->_statusColor.index() ) ) ) == false )
+            {
+                return;
+            }
+        }
+        
+        Window & win( this->_statusPane.window.value() );
         
         {
             std::lock_guard< std::recursive_mutex > l( this->_rmtx );
@@ -490,9 +762,8 @@ namespace UB
             win.print( this->_statusColor, this->_status );
         }
         
-        Screen::shared().refresh();
         win.move( 0, 0 );
-        win.refresh();
+        win.stageRefresh();
     }
     
     void UI::IMPL::_displayOutput( void )
@@ -501,7 +772,13 @@ namespace UB
         size_t y(      21 + ( ( Screen::shared().height() - 21 ) / 2 ) );
         size_t width(  Screen::shared().width() / 2 );
         size_t height( ( ( Screen::shared().height() - 21 ) / 2 ) - 2 );
-        Window win( x, y, width, height );
+        
+        if( this->_updatePane( this->_outputPane, x, y, width, height, this->_output.version() ) == false )
+        {
+            return;
+        }
+        
+        Window & win( this->_outputPane.window.value() );
         
         win.box();
         win.move( 2, 1 );
@@ -512,17 +789,11 @@ namespace UB
         y = 3;
         
         {
-            std::vector< std::string > lines;
-            std::vector< std::string > display;
             size_t                     maxLines( numeric_cast< size_t >( height ) - 4 );
+            std::vector< std::string > lines( this->_output.lines( maxLines ) );
+            std::vector< std::string > display;
             size_t                     max( 80 );
             
-            {
-                std::lock_guard< std::recursive_mutex > l( this->_rmtx );
-                
-                lines = String::lines( this->_output.string() );
-            }
-            
             if( numeric_cast< size_t >( width - 4 ) < max )
             {
                 max = numeric_cast< size_t >( width - 4 );
@@ -552,9 +823,8 @@ namespace UB
             }
         }
         
-        Screen::shared().refresh();
         win.move( 0, 0 );
-        win.refresh();
+        win.stageRefresh();
     }
     
     void UI::IMPL::_displayDebug( void )
@@ -563,7 +833,13 @@ namespace UB
         size_t y(      21 + ( ( Screen::shared().height() - 21 ) / 2 ) );
         size_t width(  Screen::shared().width() / 2 );
         size_t height( ( ( Screen::shared().height() - 21 ) / 2 ) - 2 );
-        Window win( x, y, width, height );
+        
+        if( this->_updatePane( this->_debugPane, x, y, width, height, this->_debug.version() ) == false )
+        {
+            return;
+        }
+        
+        Window & win( this->_debugPane.window.value() );
         
         win.box();
         win.move( 2, 1 );
@@ -574,14 +850,8 @@ namespace UB
         y = 3;
         
         {
-            std::vector< std::string > lines;
             size_t                     maxLines( numeric_cast< size_t >( height ) - 4 );
-            
-            {
-                std::lock_guard< std::recursive_mutex > l( this->_rmtx );
-                
-                lines = String::lines( this->_debug.string() );
-            }
+            std::vector< std::string > lines( this->_debug.lines( maxLines ) );
             
             if( lines.size() > maxLines )
             {
@@ -595,9 +865,8 @@ namespace UB
             }
         }
         
-        Screen::shared().refresh();
         win.move( 0, 0 );
-        win.refresh();
+        win.stageRefresh();
     }
     
     void UI::IMPL::_displayRegisters( void )
@@ -606,13 +875,21 @@ namespace UB
         size_t y(      0 );
         size_t width(  54 );
         size_t height( 21 );
-        Window win( x, y, width, height );
+        
+        Registers reg( this->_engine.registers() );
         
         if( Screen::shared().width() < x + width )
         {
             return;
         }
         
+        if( this->_updatePane( this->_registersPane, x, y, width, height, hashBytes( &( reg.file() ), sizeof( RegisterFile ) ) ) == false )
+        {
+            return;
+        }
+        
+        Window & win( this->_registersPane.window.value() );
+        
         win.box();
         win.move( 2, 1 );
         win.print( Color::blue(), "CPU Registers:" );
@@ -622,7 +899,6 @@ namespace UB
         y = 3;
         
         {
-            Registers   reg( this->_engine.registers() );
             std::string ah( String::toHex( reg.ah() ) );
             std::string al( String::toHex( reg.al() ) );
             std::string bh( String::toHex( reg.bh() ) );
@@ -696,9 +972,8 @@ namespace UB
             win.move( 1, y++ );
         }
         
-        Screen::shared().refresh();
         win.move( 0, 0 );
-        win.refresh();
+        win.stageRefresh();
     }
     
     void UI::IMPL::_displayRegisters( Window & window, const std::vector< std::pair< std::string, std::string > > & registers )
@@ -722,13 +997,21 @@ namespace UB
         size_t y(      0 );
         size_t width(  36 );
         size_t height( 21 );
-        Window win( x, y, width, height );
+        
+        uint32_t eflags( this->_engine.registers().eflags() );
         
         if( Screen::shared().width() < x + width )
         {
             return;
         }
         
+        if( this->_updatePane( this->_flagsPane, x, y, width, height, eflags ) == false )
+        {
+            return;
+        }
+        
+        Window & win( this->_flagsPane.window.value() );
+        
         win.box();
         win.move( 2, 1 );
         win.print( Color::blue(), "CPU Flags:" );
@@ -738,7 +1021,6 @@ namespace UB
         y = 3;
         
         {
-            uint32_t                                      eflags( this->_engine.registers().eflags() );
             std::vector< std::pair< std::string, bool > > flags;
             
             flags.push_back( { "Carry",                     ( eflags & ( 1 <<  0 ) ) != 0 } );
@@ -782,9 +1064,8 @@ namespace UB
             win.print( Color::yellow(), String::toBinary( eflags ) );
         }
         
-        Screen::shared().refresh();
         win.move( 0, 0 );
-        win.refresh();
+        win.stageRefresh();
     }
     
     void UI::IMPL::_displayStack( void )
@@ -793,38 +1074,25 @@ namespace UB
         size_t y(      0 );
         size_t width(  30 );
         size_t height( 21 );
-        Window win( x, y, width, height );
+        
+        std::vector< std::pair< uint64_t, uint16_t > > frame;
+        uint64_t                                       signature( hashBytes( nullptr, 0 ) );
         
         if( Screen::shared().width() < x + width )
         {
             return;
         }
         
-        win.box();
-        win.move( 2, 1 );
-        win.print( Color::blue(), "Stack Frame:" );
-        win.move( 1, 2 );
-        win.addHorizontalLine( width - 2 );
-        
-        y = 3;
-        
         {
             Registers reg( this->_engine.registers() );
             uint16_t  ss( reg.ss() );
             uint64_t  bp( Engine::getAddress( ss, reg.bp() ) );
             uint64_t  sp( Engine::getAddress( ss, reg.sp() ) );
             
-            std::vector< std::pair< uint64_t, uint16_t > > frame;
-            
             while( sp + 1 < bp )
             {
-                std::vector< uint8_t > data( this->_engine.read( sp, 2 ) );
-                uint16_t               i( 0 );
-                
-                if( data.size() != 2 )
-                {
-                    break;
-                }
+                const uint8_t * data( this->_engine.view( sp, 2 ) );
+                uint16_t        i( 0 );
                 
                 i   = data[ 0 ];
                 i <<= 8;
@@ -834,7 +1102,33 @@ namespace UB
                 
                 sp += 2;
             }
-            
+        }
+        
+        /*
+         * Entries are hashed field by field, as pairs contain padding.
+         */
+        for( const auto & entry: frame )
+        {
+            signature = hashBytes( &( entry.first ),  sizeof( entry.first ),  signature );
+            signature = hashBytes( &( entry.second ), sizeof( entry.second ), signature );
+        }
+        
+        if( this->_updatePane( this->_stackPane, x, y, width, height, signature ) == false )
+        {
+            return;
+        }
+        
+        Window & win( this->_stackPane.window.value() );
+        
+        win.box();
+        win.move( 2, 1 );
+        win.print( Color::blue(), "Stack Frame:" );
+        win.move( 1, 2 );
+        win.addHorizontalLine( width - 2 );
+        
+        y = 3;
+        
+        {
             if( frame.size() == 0 )
             {
                 for( size_t i = y; i < height - 1; i++ )
@@ -864,9 +1158,8 @@ namespace UB
             }
         }
         
-        Screen::shared().refresh();
         win.move( 0, 0 );
-        win.refresh();
+        win.stageRefresh();
     }
     
     void UI::IMPL::_displayInstructions( void )
@@ -875,13 +1168,19 @@ namespace UB
         size_t y(      0 );
         size_t width(  56 );
         size_t height( 21 );
-        Window win( x, y, width, height );
         
         if( Screen::shared().width() < x + width )
         {
             return;
         }
         
+        if( this->_updatePane( this->_instructionsPane, x, y, width, height, this->_codeSignature() ) == false )
+        {
+            return;
+        }
+        
+        Window & win( this->_instructionsPane.window.value() );
+        
         win.box();
         win.move( 2, 1 );
         win.print( Color::blue(), "Instructions:" );
@@ -892,29 +1191,33 @@ namespace UB
         
         try
         {
-            uint64_t                                             ip( this->_engine.registers().eip() );
-            std::vector< uint8_t >                               bytes( this->_engine.read( ip, 512 ) );
-            std::vector< std::pair< std::string, std::string > > instructions( Capstone::instructions( bytes, ip ) );
+            uint64_t        ip( this->_engine.registers().eip() );
+            const uint8_t * bytes( this->_engine.view( ip, 512 ) );
             
-            for( const auto & p: instructions )
+            for( const auto & instruction: this->_disassembler.disassemble( bytes, 512, ip, height - 4 ) )
             {
-                if( y == height - 1 )
+                std::stringstream ss;
+                
+                for( auto byte: instruction.bytes )
                 {
-                    break;
+                    ss << std::hex
+                       << std::uppercase
+                       << std::setw( 2 )
+                       << std::setfill( '0' )
+                       << static_cast< unsigned int >( byte );
                 }
                 
                 win.move( 2, y++ );
-                win.print( Color::cyan(), p.first );
+                win.print( Color::cyan(), String::toHex( instruction.address ) );
                 win.print( ": " );
-                win.print( Color::yellow(), p.second );
+                win.print( Color::yellow(), ss.str() );
             }
         }
         catch( ... )
         {}
         
-        Screen::shared().refresh();
         win.move( 0, 0 );
-        win.refresh();
+        win.stageRefresh();
     }
     
     void UI::IMPL::_displayDisassembly( void )
@@ -930,7 +1233,13 @@ namespace UB
             size_t y(      0 );
             size_t width(  Screen::shared().width() - x );
             size_t height( 21 );
-            Window win( x, y, width, height );
+            
+            if( this->_updatePane( this->_disassemblyPane, x, y, width, height, this->_codeSignature() ) == false )
+            {
+                return;
+            }
+            
+            Window & win( this->_disassemblyPane.window.value() );
             
             win.box();
             win.move( 2, 1 );
@@ -942,29 +1251,22 @@ namespace UB
             
             try
             {
-                uint64_t                                             ip( this->_engine.registers().eip() );
-                std::vector< uint8_t >                               bytes( this->_engine.read( ip, 512 ) );
-                std::vector< std::pair< std::string, std::string > > instructions( Capstone::disassemble( bytes, ip ) );
+                uint64_t        ip( this->_engine.registers().eip() );
+                const uint8_t * bytes( this->_engine.view( ip, 512 ) );
                 
-                for( const auto & p: instructions )
+                for( const auto & instruction: this->_disassembler.disassemble( bytes, 512, ip, height - 4 ) )
                 {
-                    if( y == height - 1 )
-                    {
-                        break;
-                    }
-                    
                     win.move( 2, y++ );
-                    win.print( Color::cyan(), p.first );
+                    win.print( Color::cyan(), String::toHex( instruction.address ) );
                     win.print( ": " );
-                    win.print( Color::yellow(), p.second );
+                    win.print( Color::yellow(), instruction.mnemonic + " " + instruction.operands );
                 }
             }
             catch( ... )
             {}
             
-            Screen::shared().refresh();
             win.move( 0, 0 );
-            win.refresh();
+            win.stageRefresh();
         }
     }
     
@@ -974,7 +1276,37 @@ namespace UB
         size_t y(      21 );
         size_t width(  Screen::shared().width() );
         size_t height( ( Screen::shared().height() - y ) / 2 );
-        Window win( x, y, width, height );
+        
+        if( this->_profileVisible() )
+        {
+            return;
+        }
+        
+        {
+            uint64_t signature( 0 );
+            
+            if( this->_memoryAddressPrompt.has_value() )
+            {
+                signature = hashBytes( this->_memoryAddressPrompt->data(), this->_memoryAddressPrompt->size() );
+            }
+            else
+            {
+                size_t offset( std::min( this->_memoryOffset, this->_engine.memory() ) );
+                size_t size(   0 );
+                
+                this->_memoryBytesPerLine = ( ( Screen::shared().width() - 4 ) / 4 ) - 5;
+                this->_memoryLines        = numeric_cast< size_t >( height ) - 4;
+                size                      = std::min( this->_memoryBytesPerLine * this->_memoryLines, this->_engine.memory() - offset );
+                signature                 = hashBytes( this->_engine.view( offset, size ), size, ( offset << 16 ) | this->_memoryBytesPerLine );
+            }
+            
+            if( this->_updatePane( this->_memoryPane, x, y, width, height, signature ) == false )
+            {
+                return;
+            }
+        }
+        
+        Window & win( this->_memoryPane.window.value() );
         
         win.box();
         win.move( 2, 1 );
@@ -1000,11 +1332,11 @@ namespace UB
             this->_memoryLines        = lines;
             
             {
-                size_t                 size(   this->_memoryBytesPerLine * lines );
-                size_t                 offset( this->_memoryOffset );
-                std::vector< uint8_t > mem(    this->_engine.read( offset, size ) );
+                size_t          offset( std::min( this->_memoryOffset, this->_engine.memory() ) );
+                size_t          size(   std::min( this->_memoryBytesPerLine * lines, this->_engine.memory() - offset ) );
+                const uint8_t * mem(    this->_engine.view( offset, size ) );
                 
-                for( size_t i = 0; i < mem.size(); i++ )
+                for( size_t i = 0; i < size; i++ )
                 {
                     if( i % this->_memoryBytesPerLine == 0 )
                     {
@@ -1022,7 +1354,7 @@ namespace UB
                 win.move( ( this->_memoryBytesPerLine * 3 ) + 4 + 16, y );
                 win.addVerticalLine( lines );
                 
-                for( size_t i = 0; i < mem.size(); i++ )
+                for( size_t i = 0; i < size; i++ )
                 {
                     char c = static_cast< char >( mem[ i ] );
                     
@@ -1043,9 +1375,86 @@ namespace UB
             }
         }
         
-        Screen::shared().refresh();
         win.move( 0, 0 );
-        win.refresh();
+        win.stageRefresh();
+    }
+    
+    bool UI::IMPL::_profileVisible( void ) const
+    {
+        std::lock_guard< std::recursive_mutex > l( this->_rmtx );
+        
+        return this->_profiler != nullptr && this->_showProfile;
+    }
+    
+    /*
+     * Shares the memory pane's location.
+     */
+    void UI::IMPL::_displayProfile( void )
+    {
+        size_t x(      0 );
+        size_t y(      21 );
+        size_t width(  Screen::shared().width() );
+        size_t height( ( Screen::shared().height() - y ) / 2 );
+        
+        std::shared_ptr< const Profiler > profiler;
+        std::vector< Profiler::HotSpot >  spots;
+        uint64_t                          samples;
+        
+        {
+            std::lock_guard< std::recursive_mutex > l( this->_rmtx );
+            
+            if( this->_profileVisible() == false )
+            {
+                return;
+            }
+            
+            profiler = this->_profiler;
+        }
+        
+        samples = profiler->samples();
+        spots   = profiler->top( numeric_cast< size_t >( height ) - 4 );
+        
+        if( this->_updatePane( this->_profilePane, x, y, width, height, hashBytes( spots.data(), spots.size() * sizeof( Profiler::HotSpot ), samples ) ) == false )
+        {
+            return;
+        }
+        
+        Window & win( this->_profilePane.window.value() );
+        
+        win.box();
+        win.move( 2, 1 );
+        win.print( Color::blue(), "Profile:" );
+        win.move( 12, 1 );
+        win.print( Color::magenta(), "%llu samples", static_cast< unsigned long long >( samples ) );
+        win.move( 1, 2 );
+        win.addHorizontalLine( width - 2 );
+        
+        y = 3;
+        
+        for( const auto & spot: spots )
+        {
+            double percent( ( samples > 0 ) ? ( static_cast< double >( spot.samples ) * 100.0 ) / static_cast< double >( samples ) : 0.0 );
+            
+            win.move( 2, y++ );
+            win.print( Color::cyan(), String::toHex( spot.address ) );
+            win.print( Color::yellow(), " %5.1f%% %12llu", percent, static_cast< unsigned long long >( spot.executions ) );
+            
+            try
+            {
+                const uint8_t * bytes( this->_engine.view( spot.address, spot.size ) );
+                
+                for( const auto & instruction: this->_disassembler.disassemble( bytes, spot.size, spot.address, 1 ) )
+                {
+                    win.print( "  " );
+                    win.print( instruction.mnemonic + " " + instruction.operands );
+                }
+            }
+            catch( ... )
+            {}
+        }
+        
+        win.move( 0, 0 );
+        win.stageRefresh();
     }
     
     void UI::IMPL::_memoryScrollUp( size_t n )
@@ -1078,3 +1487,16 @@ namespace UB
         this->_memoryScrollDown( this->_memoryLines );
     }
 }
+
+static uint64_t hashBytes( const void * data, size_t size, uint64_t seed )
+{
+    const uint8_t * bytes( static_cast< const uint8_t * >( data ) );
+    
+    for( size_t i = 0; i < size; i++ )
+    {
+        seed ^= bytes[ i ];
+        seed *= 0x100000001B3;
+    }
+    
+    return seed;
+}
@@ -33,6 +33,7 @@
 namespace UB
 {
     class Engine;
+    class Profiler;
     
     class UI
     {
@@ -55,11 +56,19 @@ namespace UB
             void mode( Mode mode );
             
             void run( void );
+            void stop( void );
             int  waitForUserResume( void );
             
             StringStream & output( void );
             StringStream & debug( void );
             
+            /*
+             * Shows the hottest blocks of a profiler in place of the memory
+             * pane, which can be toggled with the 'p' key.
+             * A null profiler removes the pane.
+             */
+            void profiler( const std::shared_ptr< const Profiler > & profiler );
+            
             friend void swap( UI & o1, UI & o2 );
             
         private:
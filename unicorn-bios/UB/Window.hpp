@@ -44,7 +44,21 @@ namespace UB
             
             Window & operator =( Window o );
             
+            size_t x( void )      const;
+            size_t y( void )      const;
+            size_t width( void )  const;
+            size_t height( void ) const;
+            
             void refresh( void );
+            
+            /*
+             * Copies the window to the virtual screen, without updating the
+             * terminal - The terminal is then updated once for all windows,
+             * using Screen::update.
+             */
+            void stageRefresh( void );
+            
+            void erase( void );
             void move( size_t x, size_t y );
             void print( const std::string & s );
             void print( const char * format, ... );
@@ -25,7 +25,11 @@
 #include <iostream>
 #include "UB/Arguments.hpp"
 #include "UB/Machine.hpp"
+#include "UB/FAT/Image.hpp"
+#include "UB/SparseFile.hpp"
 #include "UB/Screen.hpp"
+#include "UB/TraceFile.hpp"
+#include "UB/TraceQuery.hpp"
 
 static void showHelp( void );
 
@@ -35,6 +39,34 @@ int main( int argc, const char * argv[] )
     {
         UB::Arguments args( argc, argv );
         
+        if( args.query().length() > 0 )
+        {
+            UB::TraceFile trace( args.query() );
+            
+            UB::TraceQuery::summary( trace, std::cout );
+            
+            std::cout << std::endl;
+            
+            if( args.queryWrites().length() > 0 )
+            {
+                auto range( UB::TraceQuery::range( args.queryWrites() ) );
+                
+                UB::TraceQuery::writes( trace, range.first, range.second, args.queryCount(), std::cout );
+            }
+            else if( args.queryExec().length() > 0 )
+            {
+                auto range( UB::TraceQuery::range( args.queryExec() ) );
+                
+                UB::TraceQuery::executions( trace, range.first, range.second, args.queryCount(), std::cout );
+            }
+            else
+            {
+                UB::TraceQuery::instructions( trace, args.queryAt(), args.queryCount(), std::cout );
+            }
+            
+            return EXIT_SUCCESS;
+        }
+        
         if( args.showHelp() || args.bootImage().length() == 0 )
         {
             showHelp();
@@ -42,16 +74,26 @@ int main( int argc, const char * argv[] )
             return EXIT_SUCCESS;
         }
         
+        if( args.makeSparse().length() > 0 )
+        {
+            UB::SparseFile::create( args.bootImage(), args.makeSparse() );
+            
+            std::cout << "Created sparse image: " << args.makeSparse() << std::endl;
+            
+            return EXIT_SUCCESS;
+        }
+        
         {
-            UB::Machine * machine;
+            UB::Machine  * machine;
+            UB::FAT::Image image( args.bootImage(), args.diskCache() * 1024 * 1024 );
             
-            if( args.noUI() )
+            if( args.noUI() || args.benchmark() )
             {
-                machine = new UB::Machine( args.memory() * 1024 * 1024, args.bootImage(), UB::UI::Mode::Standard );
+                machine = new UB::Machine( args.memory() * 1024 * 1024, image, UB::UI::Mode::Standard, args.memoryFile() );
             }
             else
             {
-                machine = new UB::Machine( args.memory() * 1024 * 1024, args.bootImage(), UB::UI::Mode::Interactive );
+                machine = new UB::Machine( args.memory() * 1024 * 1024, image, UB::UI::Mode::Interactive, args.memoryFile() );
             }
             
             machine->breakOnInterrupt( args.breakOnInterrupt() );
@@ -59,6 +101,11 @@ int main( int argc, const char * argv[] )
             machine->trap( args.trap() );
             machine->debugVideo( args.debugVideo() );
             machine->singleStep( args.singleStep() );
+            machine->benchmark( args.benchmark() );
+            machine->nativeCPUID( args.nativeCPUID() );
+            machine->trace( args.trace(), args.traceRegisters(), args.traceWrites() );
+            machine->coverage( args.coverage(), args.coverageList() );
+            machine->profile( args.profile() );
             
             for( auto bp: args.breakpoints() )
             {
@@ -70,8 +117,34 @@ int main( int argc, const char * argv[] )
                UB::Screen::shared().disableColors();
             }
             
+            if( args.noUI() == false && args.benchmark() == false )
+            {
+                UB::Screen::shared().fps( args.fps() );
+            }
+            
+            machine->ui().output().maximumLines( args.logLines() );
+            machine->ui().debug().maximumLines( args.logLines() );
+            
+            if( args.outputLog().length() > 0 )
+            {
+                machine->ui().output().spill( args.outputLog() );
+            }
+            
+            if( args.debugLog().length() > 0 )
+            {
+                machine->ui().debug().spill( args.debugLog() );
+            }
             
             machine->run();
+            
+            /*
+             * Disk writes are discarded unless explicitly committed to the
+             * boot image.
+             */
+            if( args.commitDisk() )
+            {
+                machine->bootImage().commit();
+            }
         }
         
         return EXIT_SUCCESS;
@@ -104,6 +177,12 @@ static void showHelp( void )
               << std::endl
               << "                    (in megabytes). Defaults to 64MB, minimum 2MB."
               << std::endl
+              << "    --memory-file:  Maps the virtual machine's memory to a file instead of anonymous memory."
+              << std::endl
+              << "    --disk-cache:   Reads the boot image on demand, with a cache of the given size (in megabytes),"
+              << std::endl
+              << "                    instead of mapping it to memory."
+              << std::endl
               << "    --break / -b    Breaks on a specific address."
               << std::endl
               << "    --break-int:    Breaks on interrupt calls."
@@ -118,6 +197,59 @@ static void showHelp( void )
               << std::endl
               << "    --no-ui:        Don't start the user interface (output will be displayed to stdout, debug info to stderr)."
               << std::endl
+              << "                    Exits when the emulation stops."
+              << std::endl
               << "    --no-colors:    Don't use colors."
+              << std::endl
+              << "    --fps:          Maximum number of user interface updates per second (0 for no limit, updating only on events)."
+              << std::endl
+              << "                    Defaults to 30."
+              << std::endl
+              << "    --log-lines:    Number of output and debug lines kept in memory (0 for no limit)."
+              << std::endl
+              << "                    Defaults to 10000."
+              << std::endl
+              << "    --output-log:   Appends output lines discarded from memory to the given file."
+              << std::endl
+              << "    --debug-log:    Appends debug lines discarded from memory to the given file."
+              << std::endl
+              << "    --benchmark:    Runs without user interface and reports the number of executed instructions per second, with and without an instruction hook."
+              << std::endl
+              << "    --native-cpuid: Don't patch CPUID results, so the emulation can run without instruction hooks."
+              << std::endl
+              << "    --trace:        Records every executed instruction to the given file."
+              << std::endl
+              << "    --trace-regs:   Also records register changes in the trace file."
+              << std::endl
+              << "    --trace-writes: Also records memory writes in the trace file."
+              << std::endl
+              << "    --coverage:     Writes the executed basic blocks to the given file at exit, in drcov format."
+              << std::endl
+              << "    --coverage-txt: Writes the executed basic blocks to the given file at exit, as a list of addresses."
+              << std::endl
+              << "    --profile:      Samples executed code, showing hot spots in the user interface (toggled with 'p')"
+              << std::endl
+              << "                    and reporting them at exit."
+              << std::endl
+              << "    --commit-disk:  Writes disk changes back to the boot image at exit (discarded by default)."
+              << std::endl
+              << "    --make-sparse:  Converts the boot image to a sparse compressed image, written to the given"
+              << std::endl
+              << "                    file, and exits. Sparse images can be used as boot images."
+              << std::endl
+              << std::endl
+              << "Usage: unicorn-bios --query TRACE [OPTIONS]"
+              << std::endl
+              << std::endl
+              << "Query options:"
+              << std::endl
+              << std::endl
+              << "    --query-at:     Lists instructions starting at the given instruction number. Defaults to 0."
+              << std::endl
+              << "    --query-count:  Maximum number of listed instructions or writes. Defaults to 20."
+              << std::endl
+              << "    --query-writes: Lists memory writes to the given hexadecimal address range (BEGIN[:END])."
+              << std::endl
+              << "    --query-exec:   Lists executions of the given hexadecimal address range (BEGIN[:END])."
               << std::endl;
 }